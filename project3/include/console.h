@@ -2,11 +2,34 @@
 #define _CONSOLE_H_
 
 #include "types.h"
+#include "klog.h"
 
 // 基础函数声明
 void console_init(void);
 void console_putc(char c);
 void console_puts(const char *s);
+void console_write(const char *buf, uint64 n);
+
+// 原样输出一段数据，不把\n展开为\r\n（二进制跟踪帧）
+void console_write_raw(const char *buf, uint64 n);
+int console_write_user(uint64 ubuf, uint64 n, int nonblock);
+void console_flush(void);
+
+// 控制台输入的行规程
+// 规范模式：回显，处理退格、^U（删除整行）和^D（文件结束），整行输入后才能读取；
+// 原始模式：不回显也不处理编辑字符，收到的字节立即可以读取
+#define CONSOLE_CANON 0
+#define CONSOLE_RAW   1
+
+// 串口收到一个字符（中断上下文）
+void console_rx(int c);
+
+// 读取输入到用户地址ubuf，规范模式下最多读到行尾；没有输入时nonblock为0则
+// 阻塞并在唤醒后重新执行系统调用，否则返回-1
+int console_read_user(uint64 ubuf, uint64 n, int nonblock);
+
+// 设置输入模式，mode为负数时只查询，返回原来的模式
+int console_set_mode(int mode);
 int console_getc(void);
 int console_printf(const char *fmt, ...);
 int console_vprintf(const char *fmt, va_list args);
@@ -14,15 +37,94 @@ void console_test(void);
 int console_printf_main(const char *fmt, ...);
 
 /* ========== 日志模块定义 ========== */
-#define DECLARE_LOG_MODULE(name) \
-    void console_printf_##name(const char *fmt, ...);
-
-DECLARE_LOG_MODULE(MAIN)
-DECLARE_LOG_MODULE(TRAP)
-DECLARE_LOG_MODULE(SYSCALL)
-DECLARE_LOG_MODULE(TIMER)
-DECLARE_LOG_MODULE(PAGE)
-DECLARE_LOG_MODULE(QEMU)
-DECLARE_LOG_MODULE(PANIC)
+// 日志级别：模块当前的级别不低于调用的级别时才输出，可以用系统调用log_level在运行时修改
+#define LOG_OFF   0
+#define LOG_INFO  1     // console_printf_*
+#define LOG_DEBUG 2     // console_debug_*：每次系统调用这类高频信息
+
+// 异步输出的日志模块（PANIC是同步输出的，单独声明）
+#define LOG_MODULES(X) \
+    X(MAIN) X(TRAP) X(SYSCALL) X(TIMER) X(PAGE) X(QEMU) X(PROC) X(SCHED)
+
+enum log_module {
+#define LOG_MODULE_ENUM(name) LOG_MOD_##name,
+    LOG_MODULES(LOG_MODULE_ENUM)
+#undef LOG_MODULE_ENUM
+    NLOG_MODULES
+};
+
+// 各模块当前的日志级别，在调用点检查，关闭的日志不求值参数
+extern int log_levels[NLOG_MODULES];
+
+// 设置名为name的模块的级别，level为负数时只查询；返回原来的级别，模块不存在返回-1
+int console_set_log_level(const char *name, int level);
+
+// 在控制台输出所有模块的级别
+void console_print_log_levels(void);
+
+void console_printf_PANIC(const char *fmt, ...);
+
+// 写入日志缓冲区（klog.c），rl是调用点的限速状态
+void console_log(int mod, struct klog_ratelimit *rl, const char *fmt, ...);
+void klog_trace(int mod, struct klog_ratelimit *rl, const char *fmt, int nargs, uint32 strmask, ...);
+
+// Makefile中KLOG_BINARY=1时使用二进制跟踪：格式串放入不加载的.klog_fmt段，
+// 运行时只输出格式串在段内的偏移（格式ID）和参数，由tools/klogdump对照kernel.elf解码
+#ifndef KLOG_BINARY
+#define KLOG_BINARY 0
+#endif
+
+// 参数个数（最多6个，与klog.c中每条日志保存的参数个数相同）
+#define KLOG_NARGS(...) KLOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define KLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+
+// 字符串参数的位掩码：格式串不在内存中，在编译时按参数类型判断哪些参数要复制字符串
+#define KLOG_STR(i, x) (_Generic((x), char *: 1U, const char *: 1U, default: 0U) << (i))
+#define KLOG_STRMASK0() 0U
+#define KLOG_STRMASK1(a) KLOG_STR(0, a)
+#define KLOG_STRMASK2(a, b) (KLOG_STRMASK1(a) | KLOG_STR(1, b))
+#define KLOG_STRMASK3(a, b, c) (KLOG_STRMASK2(a, b) | KLOG_STR(2, c))
+#define KLOG_STRMASK4(a, b, c, d) (KLOG_STRMASK3(a, b, c) | KLOG_STR(3, d))
+#define KLOG_STRMASK5(a, b, c, d, e) (KLOG_STRMASK4(a, b, c, d) | KLOG_STR(4, e))
+#define KLOG_STRMASK6(a, b, c, d, e, f) (KLOG_STRMASK5(a, b, c, d, e) | KLOG_STR(5, f))
+#define KLOG_CAT(a, b) KLOG_CAT_(a, b)
+#define KLOG_CAT_(a, b) a##b
+#define KLOG_STRMASK(...) KLOG_CAT(KLOG_STRMASK, KLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+// 每个调用点有自己的限速状态；二进制跟踪模式下格式串是.klog_fmt段中的一个静态数组，
+// 它的地址减去段首就是格式ID
+#if KLOG_BINARY
+#define LOG_EMIT(mod, rl, fmt, ...) do { \
+        static const char klog_fmt_[] __attribute__((section(".klog_fmt"), used)) = fmt; \
+        klog_trace(mod, rl, klog_fmt_, KLOG_NARGS(__VA_ARGS__), KLOG_STRMASK(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+#else
+#define LOG_EMIT(mod, rl, fmt, ...) console_log(mod, rl, fmt, ##__VA_ARGS__)
+#endif
+
+#define LOG_CALL(name, level, fmt, ...) do { \
+        if (log_levels[LOG_MOD_##name] >= (level)) { \
+            static struct klog_ratelimit klog_rl_; \
+            LOG_EMIT(LOG_MOD_##name, &klog_rl_, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define console_printf_MAIN(fmt, ...)    LOG_CALL(MAIN, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_TRAP(fmt, ...)    LOG_CALL(TRAP, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_SYSCALL(fmt, ...) LOG_CALL(SYSCALL, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_TIMER(fmt, ...)   LOG_CALL(TIMER, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_PAGE(fmt, ...)    LOG_CALL(PAGE, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_QEMU(fmt, ...)    LOG_CALL(QEMU, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_PROC(fmt, ...)    LOG_CALL(PROC, LOG_INFO, fmt, ##__VA_ARGS__)
+#define console_printf_SCHED(fmt, ...)   LOG_CALL(SCHED, LOG_INFO, fmt, ##__VA_ARGS__)
+
+#define console_debug_MAIN(fmt, ...)     LOG_CALL(MAIN, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_TRAP(fmt, ...)     LOG_CALL(TRAP, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_SYSCALL(fmt, ...)  LOG_CALL(SYSCALL, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_TIMER(fmt, ...)    LOG_CALL(TIMER, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_PAGE(fmt, ...)     LOG_CALL(PAGE, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_QEMU(fmt, ...)     LOG_CALL(QEMU, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_PROC(fmt, ...)     LOG_CALL(PROC, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define console_debug_SCHED(fmt, ...)    LOG_CALL(SCHED, LOG_DEBUG, fmt, ##__VA_ARGS__)
 
 #endif // _CONSOLE_H_
\ No newline at end of file
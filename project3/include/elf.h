@@ -8,9 +8,17 @@
 // ELF文件魔数
 #define ELF_MAGIC 0x464C457F  // "\x7FELF" in little endian
 
+// 目标架构
+#define ELF_MACHINE_RISCV 243
+
 // 程序头类型
 #define ELF_PROG_LOAD 1  // 可加载段
 
+// 程序头标志
+#define ELF_PROG_FLAG_EXEC  1
+#define ELF_PROG_FLAG_WRITE 2
+#define ELF_PROG_FLAG_READ  4
+
 // ELF文件头
 struct elfhdr {
   uint32 magic;       // 魔数，必须为ELF_MAGIC
@@ -0,0 +1,16 @@
+#ifndef _EXEC_H_
+#define _EXEC_H_
+
+#include "types.h"
+#include "proc.h"
+
+#define MAXARG     16       // argv/envp的最大项数
+#define MAXARGLEN  256      // 每个参数字符串的最大长度
+
+// 从initramfs加载ELF程序，为任务t建立新的地址空间和初始上下文
+// path是内核中的字符串；user为1时argv/envp是当前地址空间中的用户指针，
+// 通过uaccess读取，访问出错返回-1；为0时是内核指针
+// 成功时返回argc，t->mm被替换，旧地址空间由调用者在切换satp后释放
+int exec_load(struct task *t, const char *path, char *const argv[], char *const envp[], int user);
+
+#endif // _EXEC_H_
@@ -0,0 +1,62 @@
+#ifndef _FILE_H_
+#define _FILE_H_
+
+#include "types.h"
+
+#define NFILE   32      // 系统打开文件表大小
+#define NOFILE  8       // 每个任务的文件描述符数量
+#define MAXPATH 128     // 路径的最大长度，包括结尾的'\0'
+
+// open的flags，目前只支持只读
+#define O_RDONLY 0
+
+// 打开的文件，多个文件描述符（fork/dup2）可以共享同一个file
+struct file {
+    enum { FD_NONE, FD_CONSOLE, FD_INITRD } type;
+    int ref;                // 引用计数
+    int readable;
+    int writable;
+    const uint8 *data;      // FD_INITRD：文件在initramfs中的数据
+    uint64 size;
+    uint64 off;             // 读写偏移
+};
+
+struct task;
+
+// 打开控制台，返回的file引用计数为1
+struct file *file_console(void);
+
+// 打开initramfs中的文件（只读）
+struct file *file_open(const char *path, int flags);
+
+// 增加引用计数
+struct file *filedup(struct file *f);
+
+// 减少引用计数，为0时释放
+void fileclose(struct file *f);
+
+// 读写文件，buf是当前地址空间中的用户地址，地址无效时返回-1
+// 控制台没有输入时：nonblock为0则阻塞（系统调用唤醒后重新执行），否则返回-1
+// 控制台发送缓冲区已满时：nonblock为0则阻塞，否则只写入放得下的部分（可能为0）
+int fileread(struct file *f, void *buf, uint64 n, int nonblock);
+int filewrite(struct file *f, const void *buf, uint64 n, int nonblock);
+
+// 把f安装到任务t的最小空闲描述符上，返回描述符，已满返回-1
+int fd_install(struct task *t, struct file *f);
+
+// 取当前任务的文件描述符，无效返回NULL
+struct file *fd_get(int fd);
+
+// 让newfd指向oldfd的文件，newfd原先打开的文件被关闭
+int fd_dup2(struct task *t, int oldfd, int newfd);
+
+// 关闭任务t的文件描述符
+int fd_close(struct task *t, int fd);
+
+// 复制src的描述符表到dst（fork/spawn），各文件引用计数加一
+void fd_copy(struct task *dst, struct task *src);
+
+// 关闭任务t的所有描述符
+void fd_close_all(struct task *t);
+
+#endif // _FILE_H_
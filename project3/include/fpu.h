@@ -0,0 +1,41 @@
+#ifndef _FPU_H_
+#define _FPU_H_
+
+#include "types.h"
+
+// 浮点上下文的延迟保存和恢复
+//
+// 任务切换时不无条件保存和加载浮点寄存器：
+// - 切换出去时只在sstatus.FS为Dirty（任务写过浮点寄存器）时保存到任务中；
+// - 切换进来时把FS设为Off，任务第一次执行浮点指令触发非法指令异常，
+//   这时再从任务中加载浮点寄存器并把FS设为Clean，重新执行该指令。
+// 如果本hart的浮点寄存器仍是该任务上次的内容，切换进来时直接设为Clean。
+// 不使用浮点的任务切换时没有任何额外开销。
+// 内核自身不能使用浮点指令：处理trap时FS仍是被中断任务的状态。
+// 没有启用向量扩展，VS始终为Off。
+
+struct task;
+
+// 浮点寄存器的保存区域
+struct fpu_state {
+    uint64 f[32];
+    uint64 fcsr;
+};
+
+// 关闭本hart的浮点和向量单元，每个hart启动时调用一次
+void fpu_init_hart(void);
+
+// 任务切换：按需保存prev的浮点寄存器，为next设置FS（调用者持有sched_lock）
+void fpu_switch(struct task *prev, struct task *next);
+
+// 来自U模式的非法指令异常：FS为Off时加载当前任务的浮点寄存器，
+// 返回1表示应重新执行该指令；不是浮点单元关闭导致的返回0
+int fpu_trap(void);
+
+// fork：子进程得到父进程（当前任务）浮点寄存器的副本
+void fpu_fork(struct task *c, struct task *p);
+
+// exec：丢弃任务的浮点上下文，新程序从全零的寄存器开始
+void fpu_reset(struct task *t);
+
+#endif // _FPU_H_
@@ -0,0 +1,25 @@
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include "types.h"
+
+struct task;
+
+// futex操作
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+// 初始化等待队列
+void futex_init();
+
+// 当前任务在用户地址uaddr上等待：*uaddr仍等于val时睡眠，直到被futex_wake唤醒
+// 返回0表示已进入等待（或被唤醒），值不相等或地址无效返回-1
+int futex_wait(uint64 uaddr, uint32 val);
+
+// 唤醒最多n个在uaddr上等待的任务，返回唤醒的数量
+int futex_wake(uint64 uaddr, int n);
+
+// 退出中的任务离开它所在的等待队列
+void futex_cancel(struct task *t);
+
+#endif // _FUTEX_H_
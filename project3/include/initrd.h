@@ -0,0 +1,13 @@
+#ifndef _INITRD_H_
+#define _INITRD_H_
+
+#include "types.h"
+
+// 检查os.bin中的用户程序归档（cpio newc格式）
+void initrd_init();
+
+// 按路径查找归档中的文件，返回文件数据在内存中的地址和大小
+// 成功返回0，找不到返回-1
+int initrd_lookup(const char *path, const uint8 **data, uint64 *size);
+
+#endif // _INITRD_H_
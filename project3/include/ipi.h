@@ -0,0 +1,26 @@
+#ifndef _IPI_H_
+#define _IPI_H_
+
+#include "types.h"
+
+// 核间中断：通过CLINT的MSIP触发目标hart的机器软件中断，
+// M模式入口把它转发为S模式软件中断，目标hart在trap_handler中处理消息
+
+#define NIPIMSG 16          // 每个hart的消息队列长度
+
+// 初始化当前hart的消息队列
+void ipi_init();
+
+// 请求目标hart重新调度（合并重复的请求，不占用消息队列）
+void ipi_resched(int cpu);
+
+// 在目标hart的中断上下文中执行fn(arg)，队列满返回-1
+int ipi_call(int cpu, void (*fn)(void *), void *arg);
+
+// 处理本hart收到的核间中断，由trap_handler在软件中断时调用
+void ipi_handler();
+
+// 本hart累计收到的核间中断次数
+uint64 ipi_count(int cpu);
+
+#endif // _IPI_H_
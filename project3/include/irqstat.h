@@ -0,0 +1,42 @@
+#ifndef _IRQSTAT_H_
+#define _IRQSTAT_H_
+
+#include "types.h"
+
+// 中断延迟统计：每个hart、每种中断源一组log2直方图，单位是timebase tick。
+// 进入延迟 = 处理函数开始 - 中断触发时刻，退出延迟 = 处理函数结束 - 触发时刻。
+// 触发时刻对时钟中断是写入stimecmp的到期时间；外部设备无法得知发出中断的
+// 时刻，使用trap入口读到的时间。统计只由所属hart在关中断时更新。
+
+#define IRQ_HIST_BUCKETS 16     // 2^15 tick = 3.2ms，更大的延迟放入最后一个桶
+
+enum irq_source {
+    IRQ_SRC_TIMER,
+    IRQ_SRC_EXTERNAL,
+    NIRQ_SRC
+};
+
+// 与ulib.h中的struct irq_stat布局一致
+struct irq_stat {
+    uint64 count;
+    uint64 entry_sum;                       // 进入延迟之和与最大值
+    uint64 entry_max;
+    uint64 exit_sum;                        // 退出延迟之和与最大值
+    uint64 exit_max;
+    uint64 entry_hist[IRQ_HIST_BUCKETS];    // 桶b: [2^b, 2^(b+1)) tick，桶0包括0
+    uint64 exit_hist[IRQ_HIST_BUCKETS];
+};
+
+// 中断处理函数开始时调用，asserted是中断触发的时刻
+void irq_latency_entry(enum irq_source src, uint64 asserted);
+
+// 中断处理函数结束时调用，asserted与irq_latency_entry相同
+void irq_latency_exit(enum irq_source src, uint64 asserted);
+
+// 取hart的一种中断源的统计，参数无效返回-1
+int irq_stat_get(int hart, int src, struct irq_stat *st);
+
+// 在控制台输出所有在线hart的统计
+void irq_stat_print(void);
+
+#endif // _IRQSTAT_H_
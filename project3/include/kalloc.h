@@ -0,0 +1,27 @@
+#ifndef _KALLOC_H_
+#define _KALLOC_H_
+
+#include "types.h"
+
+#define PGSIZE  4096
+#define PGSHIFT 12
+
+#define PGROUNDUP(sz)  (((sz) + PGSIZE - 1) & ~((uint64)PGSIZE - 1))
+#define PGROUNDDOWN(a) ((a) & ~((uint64)PGSIZE - 1))
+
+// 初始化物理页分配器
+void kinit();
+
+// 分配一个物理页，内容未初始化，失败返回NULL
+void *kalloc();
+
+// 分配一个已清零的物理页，优先使用kworker预先清零的页
+void *kalloc_zeroed();
+
+// 释放物理页
+void kfree(void *pa);
+
+// 空闲页数量
+uint64 kfree_pages();
+
+#endif // _KALLOC_H_
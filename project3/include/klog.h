@@ -0,0 +1,40 @@
+#ifndef _KLOG_H_
+#define _KLOG_H_
+
+#include "types.h"
+
+// 内核日志缓冲：每个hart一个单生产者环形缓冲区。
+// 日志模块（console_printf_*）只把前缀、格式串和参数写入本hart的缓冲区，
+// 不获取任何锁；hart 0的时钟中断（klog_tick）发现有待输出的日志时触发SOFTIRQ_LOG，
+// 格式化和串口输出在这个软中断中完成。
+// 缓冲区满时丢弃新的日志并计数，输出时报告丢弃的条数。
+
+// 每个调用点的限速：每秒最多输出KLOG_RATELIMIT_BURST条，其余的只计数，
+// 下一秒该调用点第一条日志输出之前报告抑制的条数。多个hart用原子操作更新
+#define KLOG_RATELIMIT_BURST 40     // 足够输出一次完整的寄存器转储（32行）
+
+struct klog_ratelimit {
+    uint64 begin;           // 当前一秒窗口的开始时间
+    uint32 count;           // 窗口内的日志数
+    uint32 suppressed;      // 窗口内被抑制的日志数
+};
+
+// 写入一条日志（任何上下文，包括中断处理函数和持有调度器锁时）
+// %s参数在写入时直接读取，必须指向内核内存；用户字符串先用strncpy_from_user复制
+void klog_write(const char *prefix, const char *fmt, struct klog_ratelimit *rl, va_list args);
+
+// 二进制跟踪模式（KLOG_BINARY）下写入一条日志：prefix和fmt位于不加载的
+// .klog_fmt段，只用来计算ID，不能读取；nargs和strmask（哪些参数是字符串）在编译时得到
+void klog_write_trace(const char *prefix, const char *fmt, struct klog_ratelimit *rl,
+                      int nargs, uint32 strmask, va_list args);
+
+// hart 0的时钟中断中调用：有待输出的日志时触发SOFTIRQ_LOG
+void klog_tick(void);
+
+// 在当前上下文中同步输出所有hart的日志，用于系统挂起之前
+void klog_flush(void);
+
+// 注册SOFTIRQ_LOG的处理函数（hart 0调用一次）
+void klog_init(void);
+
+#endif // _KLOG_H_
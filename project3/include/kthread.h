@@ -0,0 +1,29 @@
+#ifndef _KTHREAD_H_
+#define _KTHREAD_H_
+
+#include "types.h"
+#include "proc.h"
+
+#define NKTHREAD           8      // 内核线程栈的数量
+#define KTHREAD_STACK_SIZE 4096
+
+// 创建内核线程，在S模式下执行fn(arg)，fn返回后线程退出
+struct task *kthread_create(const char *name, void (*fn)(void *), void *arg);
+
+// 同kthread_create，线程只在指定的hart上运行
+struct task *kthread_create_on(const char *name, void (*fn)(void *), void *arg, int cpu);
+
+// 内核线程通过S模式ecall进入调度器
+void kthread_yield();
+void kthread_sleep(uint64 milliseconds);
+void kthread_exit() __attribute__((noreturn));
+
+// 当前内核线程阻塞，直到被sched_wakeup唤醒或wakeup_time被置0
+// 调用者必须已经关中断，返回时中断仍为关闭状态
+void kthread_park();
+
+// kthread_park的前半部分：只把当前线程标记为阻塞，之后调用kthread_yield切换出去
+// 用于在锁内检查条件并标记，解锁后再切换，唤醒方在同一把锁内检查线程状态
+void kthread_park_prepare();
+
+#endif // _KTHREAD_H_
@@ -0,0 +1,42 @@
+// memlayout.h - 物理内存和用户地址空间布局
+
+#ifndef _MEMLAYOUT_H_
+#define _MEMLAYOUT_H_
+
+// QEMU virt机器的设备地址
+#define UART0_BASE      0x10000000ULL
+#define CLINT_BASE      0x02000000ULL
+#define PLIC_BASE       0x0c000000ULL
+
+// CLINT中每个hart的机器软件中断寄存器，写1触发、写0清除
+#define CLINT_MSIP(hart) (CLINT_BASE + 4 * (hart))
+
+// 物理内存：QEMU默认128MB，从0x80000000开始
+// QEMU把整个os.bin加载到0x80000000，所以磁盘偏移与物理地址一一对应
+#define RAMBASE         0x80000000ULL
+#define PHYSTOP         (RAMBASE + 128 * 1024 * 1024)
+#define KERNBASE        0x80200000ULL
+
+// 其他hart在bootloader中轮询这个地址，hart 0写入内核入口后它们开始运行
+// 位于bootloader栈顶（向下增长）和内核之间，不会被页分配器使用
+#define BOOT_RELEASE_ADDR 0x80100000ULL
+
+// 用户程序归档（initramfs）在os.bin中的位置
+#define SECTOR_SIZE     512
+#define INITRD_SECTOR   32768                   // 16MB处
+#define INITRD_BASE     (RAMBASE + INITRD_SECTOR * SECTOR_SIZE)
+#define INITRD_MAX      (8 * 1024 * 1024)
+
+// 用户地址空间位于第二个1GB区域：
+// 第一个1GB是设备，第三个1GB是内核和物理内存，这两块由所有页表共享
+#define USER_BASE       0x40000000ULL
+#define USER_STACK_TOP  0x80000000ULL
+#define USER_STACK_PAGES 4
+// 主线程栈底，下方保留一页不映射作为保护页
+#define USER_STACK_BOTTOM (USER_STACK_TOP - USER_STACK_PAGES * 4096)
+// 只读数据页（vDSO）在保护页之下：[时间页][进程页][保护页][栈]
+// 时间页由所有进程共享，进程页保存pid；堆（sbrk）不能越过数据页
+#define USER_VDATA        (USER_STACK_BOTTOM - 3 * 4096)
+#define USER_HEAP_LIMIT   USER_VDATA
+
+#endif // _MEMLAYOUT_H_
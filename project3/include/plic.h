@@ -0,0 +1,44 @@
+#ifndef _PLIC_H_
+#define _PLIC_H_
+
+#include "types.h"
+
+// QEMU virt的平台级中断控制器（PLIC），只使用各hart的S模式上下文
+
+#define PLIC_NSOURCES   64      // 支持的中断源编号范围[1, 64)，0表示没有中断
+#define PLIC_PRIO_MAX   7       // 优先级1-7，0表示屏蔽
+
+// 中断源编号
+#define UART0_IRQ 10
+
+// 设备中断处理函数，在中断上下文中调用，中断保持关闭
+typedef void (*irq_handler_t)(int irq, void *arg);
+
+// 清除所有中断源的优先级（hart 0启动时调用一次）
+void plic_init(void);
+
+// 设置本hart S模式上下文的阈值，按已注册的中断源设置使能位（每个hart启动时调用）
+void plic_init_hart(void);
+
+// 注册中断源irq的处理函数，设置优先级并在hart_mask中的hart上使能；
+// 中断源无效、优先级无效或已被注册时返回-1
+int request_irq(int irq, irq_handler_t fn, void *arg, int priority, uint64 hart_mask);
+
+// 注销处理函数，在所有hart上屏蔽中断源
+void free_irq(int irq);
+
+// 修改已注册中断源的优先级
+int plic_set_priority(int irq, int priority);
+
+// 设置本hart的优先级阈值：只有优先级大于阈值的中断源能打断本hart
+void plic_set_threshold(int threshold);
+
+// 外部中断处理：反复claim、调用处理函数、complete，直到本hart没有待处理的中断源
+// 返回处理的中断数
+int plic_dispatch(void);
+
+// 中断源被处理的次数（所有hart合计），以及claim到未注册中断源的次数
+uint64 plic_irq_count(int irq);
+uint64 plic_spurious_count(void);
+
+#endif // _PLIC_H_
@@ -0,0 +1,30 @@
+#ifndef _PRINTF_H_
+#define _PRINTF_H_
+
+#include "types.h"
+
+// 内核和用户库共用的格式化实现（lib/printf.c）
+// 支持的格式：%[0][宽度][l]转换字符，转换字符为c、s、d、u、x、p和%，
+// 宽度不足时左边补空格，有0标志的数字左边补0
+
+// 格式化输出的目标缓冲区。缓冲区满时调用flush（由它输出buf中的len字节并把len清零），
+// flush为NULL时多出的部分被丢弃，只计入total
+struct printbuf {
+    char *buf;
+    size_t size;
+    size_t len;             // 缓冲区中的字节数
+    size_t total;           // 格式化产生的总字节数
+    void (*flush)(struct printbuf *pb);
+    void *arg;              // 供flush使用
+};
+
+#define PRINTBUF_INIT(b, n, f, a) { (b), (n), 0, 0, (f), (a) }
+
+// 格式化到pb，返回这次产生的字节数；有flush时结束前输出缓冲区中剩余的内容
+int vbprintf(struct printbuf *pb, const char *fmt, va_list args);
+
+// 格式化到buf，最多写入size-1个字符并以'\0'结尾，返回完整输出需要的长度
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+int snprintf(char *buf, size_t size, const char *fmt, ...);
+
+#endif // _PRINTF_H_
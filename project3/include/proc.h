@@ -0,0 +1,190 @@
+#ifndef _PROC_H_
+#define _PROC_H_
+
+#include "types.h"
+#include "fpu.h"
+#include "vm.h"
+#include "file.h"
+#include "spawn.h"
+#include "spinlock.h"
+
+#define NCPU           4    // 最大hart数量
+#define CPU_MASK_ALL   ((1ULL << NCPU) - 1)
+#define NTASK          16   // 最大任务数量
+#define TASK_NAME_LEN  16
+
+// 任务状态
+enum task_state {
+    TASK_UNUSED,
+    TASK_NEW,               // 已分配，尚在初始化，不参与调度
+    TASK_RUNNABLE,
+    TASK_RUNNING,
+    TASK_SLEEPING,
+    TASK_ZOMBIE,
+};
+
+// 调度类，数值越大优先级越高
+enum sched_class {
+    SCHED_CLASS_IDLE,
+    SCHED_CLASS_FAIR,
+    SCHED_CLASS_EDF,
+};
+
+// EDF调度实体，时间单位均为timebase tick
+struct edf_entity {
+    uint64 runtime;         // 每个周期的执行预算
+    uint64 deadline;        // 相对截止时间
+    uint64 period;          // 周期
+    uint64 bw;              // 占用带宽 runtime/period（定点数）
+
+    uint64 abs_deadline;    // 当前作业的绝对截止时间
+    uint64 next_release;    // 下一个作业的释放时间
+    uint64 remaining;       // 当前作业剩余预算
+    int throttled;          // 预算耗尽，等待下一周期
+    int job_done;           // 当前作业已完成（已调用yield）
+    int missed;             // 当前作业已计入错过截止时间
+
+    uint64 nr_jobs;         // 已完成作业数
+    uint64 nr_misses;       // 错过截止时间的作业数
+};
+
+// 地址空间，同一进程的线程共享
+struct mm {
+    struct spinlock lock;   // 保护brk
+    pagetable_t pagetable;
+    uint64 brk;             // 堆顶（sbrk）
+    int ref;                // 使用该地址空间的任务数，原子操作
+    struct spinlock ring_lock;  // 串行化提交/完成队列的建立和处理
+    uint64 ring;            // 提交/完成队列共享页的用户地址，0表示未建立
+};
+
+// trap帧：用户任务在U模式下trap时，trap_vector把寄存器直接保存在这里。
+// trap_vector使用固定偏移访问kernel_sp（256）和hartid（264）
+struct trapframe {
+    uint64 regs[32];        // 布局与trap_vector的寄存器数组一致
+    uint64 kernel_sp;       // 处理trap使用的内核栈顶
+    uint64 hartid;          // 任务正在运行的hart，trap_vector从这里恢复tp
+};
+
+// 任务控制块
+struct task {
+    int pid;                // 线程ID
+    int tgid;               // 所属进程的ID（主线程的pid），getpid返回它
+    enum task_state state;
+    enum sched_class policy;
+    char name[TASK_NAME_LEN];
+    struct mm *mm;          // 用户地址空间，内核线程为NULL
+    struct task *parent;    // 父进程，NULL表示退出后无人等待（包括线程）
+    int xstate;             // 退出码，由wait取回
+    int waiting;            // 阻塞在wait中，子进程退出时唤醒
+    struct file *ofile[NOFILE];
+    uint64 clear_tid;       // 线程退出时清零的用户地址，用于join
+    int killed;             // 同进程的其他线程调用了exit，返回用户态前退出
+    int traced;             // 系统调用写入跟踪缓冲区（strace_ctl）
+    void *wait_chan;        // 阻塞等待的对象（sched_block），NULL表示没有
+    int restart_syscall;    // 当前系统调用阻塞，唤醒后重新执行（syscall_restart）
+    uint64 futex_key;       // 正在等待的futex（物理地址），0表示不在等待队列中
+    struct task *futex_next;
+
+    int on_cpu;             // 正在某个hart上运行（包括切换过程中）
+    int cpu;                // 所属hart：在该hart上等待运行，负载均衡时改变
+    uint64 last_ran;        // 上次被切换出去的时间，用于判断缓存是否还是热的
+    uint64 nr_migrations;   // 被迁移到其他hart的次数
+    uint64 cpus_allowed;    // 允许运行的hart掩码（sched_setaffinity）
+
+    // 被切换出去时的上下文：frame指向保存的寄存器数组，切换任务只交换指针。
+    // 用户任务的寄存器总是保存在tf中；S模式任务在自己的栈上保存，
+    // 新任务从tf开始运行
+    struct trapframe tf;
+    uint64 *frame;
+    uint64 sepc;
+    uint64 sstatus;         // 仅保存SPP/SPIE位
+
+    // 浮点上下文（fpu.c），只在使用过浮点的任务被切换出去时保存
+    struct fpu_state fpu;
+    int fpu_cpu;            // 浮点寄存器最后加载到的hart，-1表示没有
+    uint64 fpu_saves;       // 保存和加载浮点寄存器的次数（sched_getstat）
+    uint64 fpu_restores;
+
+    uint64 wakeup_time;     // 睡眠任务的唤醒时间
+    uint64 exec_start;      // 本次开始运行的时间
+    uint64 sum_exec;        // 累计运行时间
+    uint64 vruntime;        // 公平调度类的虚拟运行时间
+
+    struct edf_entity edf;
+};
+
+// 每个hart的状态
+struct cpu {
+    struct task *cur;       // 当前运行的任务
+    struct task *idle;      // 本hart的空闲任务
+    int need_resched;       // 从trap返回前需要重新调度
+    int nr_running;         // 上次调度时可在本hart运行的非空闲任务数
+    uint64 busy_time;       // 运行非空闲任务的累计时间，用于计算利用率
+    uint64 nr_migrations;   // 迁入本hart的任务数
+    uint64 next_balance;    // 下一次周期负载均衡的时间
+    int intr_depth;         // trap处理嵌套深度，大于0表示处于中断上下文
+    uint64 *trap_regs;      // 当前trap保存的寄存器数组，fork从这里复制父进程的上下文
+};
+
+extern struct cpu cpus[NCPU];
+extern struct task tasks[NTASK];
+
+// 调度器锁：保护任务表、任务状态和父子关系
+extern struct spinlock sched_lock;
+
+// 获取当前hart
+struct cpu *mycpu(void);
+
+// 获取当前任务
+struct task *current_task(void);
+
+// 分配一个任务控制块，失败返回NULL
+struct task *task_alloc(const char *name);
+
+// 释放任务控制块
+void task_free(struct task *t);
+
+// 从initramfs加载程序，创建用户态任务
+struct task *task_create_user(const char *path, char *const argv[]);
+
+// 复制当前任务，子进程从fork返回0
+int task_fork(void);
+
+// 直接从程序文件创建子进程，不复制父进程地址空间
+// path是内核中的字符串，argv/envp和fa是当前地址空间中的用户指针
+int task_spawn(const char *path, char *const argv[], char *const envp[],
+               const struct spawn_file_actions *fa);
+
+// 等待任意子进程退出；没有已退出的子进程时阻塞，子进程退出时唤醒并重新执行
+int task_wait(uint64 status);
+
+// 创建与当前任务共享地址空间的线程，从fn(arg)开始在stack上运行，tp=tls
+int task_clone(uint64 fn, uint64 arg, uint64 stack, uint64 tls, uint64 ctid);
+
+// 当前任务退出
+void task_exit(int code);
+
+// 当前进程的所有线程退出
+void task_exit_group(int code);
+
+// 当前进程的其他线程在返回用户态前退出
+void task_kill_threads(void);
+
+// 创建地址空间，引用计数为1
+struct mm *mm_create(pagetable_t pagetable);
+
+// 增加/减少地址空间的引用，最后一个引用释放页表
+struct mm *mm_get(struct mm *mm);
+void mm_put(struct mm *mm);
+
+// 扩展当前进程的堆，返回原来的堆顶，失败返回-1
+uint64 mm_sbrk(struct mm *mm, int64 n);
+
+// 已退出的任务被切换出去后调用（此时不再使用它的页表）
+void task_exited(struct task *t);
+
+// 创建S模式内核任务，调用者完成设置后用sched_wakeup使其就绪
+struct task *task_create_kernel(const char *name, void (*fn)(void), uint64 stack_top);
+
+#endif // _PROC_H_
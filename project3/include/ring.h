@@ -0,0 +1,52 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+#include "types.h"
+
+// 提交/完成队列：进程与内核共享一页内存，用户程序一次提交多个操作，
+// 由一次ring_enter系统调用全部处理，结果写入完成队列
+
+#define RING_ENTRIES 64     // 队列长度，2的幂
+
+// 操作类型
+#define RING_OP_NOP   0
+#define RING_OP_WRITE 1     // fd, addr=缓冲区, len；控制台发送缓冲区满时不阻塞，结果为写入的字节数
+#define RING_OP_READ  2     // fd, addr=缓冲区, len；控制台没有输入时不阻塞，结果为-1
+#define RING_OP_OPEN  3     // addr=路径, len=flags
+#define RING_OP_CLOSE 4     // fd
+#define RING_OP_SLEEP 5     // len=毫秒，之后的提交留到下一次ring_enter
+
+// 提交队列项
+struct ring_sqe {
+    uint32 op;
+    int32 fd;
+    uint64 addr;
+    uint64 len;
+    uint64 user_data;       // 原样复制到完成队列项
+};
+
+// 完成队列项
+struct ring_cqe {
+    uint64 user_data;
+    int64 res;              // 与对应系统调用的返回值相同
+};
+
+// 共享页的布局 - 用户库中有相同布局的定义
+// 下标自由增长，使用时对RING_ENTRIES取模：
+// sq_tail和cq_head由用户推进，sq_head和cq_tail由内核推进
+struct ring_shared {
+    volatile uint32 sq_head;
+    volatile uint32 sq_tail;
+    volatile uint32 cq_head;
+    volatile uint32 cq_tail;
+    struct ring_sqe sqes[RING_ENTRIES];
+    struct ring_cqe cqes[RING_ENTRIES];
+};
+
+// 为当前进程建立共享页（每个进程一个，线程共用），返回用户地址，失败返回-1
+uint64 ring_setup(void);
+
+// 处理最多to_submit个提交（每次最多RING_ENTRIES个），返回处理的数量，没有建立共享页返回-1
+int ring_enter(uint32 to_submit);
+
+#endif // _RING_H_
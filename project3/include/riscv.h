@@ -15,6 +15,13 @@
 #define SSTATUS_SIE (1L << 1)  // Supervisor Interrupt Enable
 #define SSTATUS_SPIE (1L << 5) // Supervisor Previous Interrupt Enable
 #define SSTATUS_SPP (1L << 8)  // Supervisor Previous Privilege
+#define SSTATUS_SUM (1L << 18) // Supervisor User Memory access
+#define SSTATUS_VS  (3L << 9)  // 向量单元状态，取值同FS
+#define SSTATUS_FS  (3L << 13) // 浮点单元状态
+#define SSTATUS_FS_OFF     (0L << 13) // 关闭：浮点指令触发非法指令异常
+#define SSTATUS_FS_INITIAL (1L << 13) // 寄存器为初始值
+#define SSTATUS_FS_CLEAN   (2L << 13) // 寄存器与保存的副本一致
+#define SSTATUS_FS_DIRTY   (3L << 13) // 寄存器被修改过，硬件在写浮点寄存器时设置
 
 // sie寄存器位
 #define SIE_SSIE (1L << 1)     // Software Interrupt Enable
@@ -35,6 +42,15 @@ static inline void w_sstatus(uint64 x) {
   WRITE_CSR(sstatus, x);
 }
 
+// 开关S模式中断
+static inline void intr_on() {
+  w_sstatus(r_sstatus() | SSTATUS_SIE);
+}
+
+static inline void intr_off() {
+  w_sstatus(r_sstatus() & ~SSTATUS_SIE);
+}
+
 // sie寄存器操作
 static inline uint64 r_sie() {
   return READ_CSR(sie);
@@ -58,6 +74,8 @@ static inline uint64 r_stvec() {
   return READ_CSR(stvec);
 }
 
+#define STVEC_MODE_VECTORED 1   // 中断进入BASE+4*原因码
+
 static inline void w_stvec(uint64 x) {
   WRITE_CSR(stvec, x);
 }
@@ -81,6 +99,16 @@ static inline uint64 r_stval() {
   return READ_CSR(stval);
 }
 
+// sscratch寄存器操作
+// 在用户态运行时保存本hart的内核trap栈顶，在内核中为0
+static inline uint64 r_sscratch() {
+  return READ_CSR(sscratch);
+}
+
+static inline void w_sscratch(uint64 x) {
+  WRITE_CSR(sscratch, x);
+}
+
 // satp寄存器操作
 static inline uint64 r_satp() {
   return READ_CSR(satp);
@@ -95,4 +123,122 @@ static inline void sfence_vma() {
   asm volatile("sfence.vma zero, zero");
 }
 
+// tp寄存器操作（内核中tp保存当前hart ID）
+static inline uint64 r_tp() {
+  uint64 x;
+  asm volatile("mv %0, tp" : "=r"(x));
+  return x;
+}
+
+static inline void w_tp(uint64 x) {
+  asm volatile("mv tp, %0" :: "r"(x));
+}
+
+// 读取当前hart ID
+static inline int cpuid() {
+  return (int)r_tp();
+}
+
+// time寄存器（需要mcounteren.TM允许S/U模式读取）
+static inline uint64 r_time() {
+  uint64 x;
+  asm volatile("rdtime %0" : "=r"(x));
+  return x;
+}
+
+// cycle寄存器（需要mcounteren.CY允许S/U模式读取）
+static inline uint64 r_cycle() {
+  uint64 x;
+  asm volatile("rdcycle %0" : "=r"(x));
+  return x;
+}
+
+// stimecmp寄存器（Sstc扩展，CSR编号0x14d）
+static inline void w_stimecmp(uint64 x) {
+  WRITE_CSR(0x14d, x);
+}
+
+/* ========== M模式寄存器，仅在进入S模式之前使用 ========== */
+
+// mstatus寄存器位
+#define MSTATUS_MPP_MASK (3L << 11) // Machine Previous Privilege
+#define MSTATUS_MPP_S    (1L << 11)
+
+static inline uint64 r_mstatus() {
+  return READ_CSR(mstatus);
+}
+
+static inline void w_mstatus(uint64 x) {
+  WRITE_CSR(mstatus, x);
+}
+
+static inline void w_mepc(uint64 x) {
+  WRITE_CSR(mepc, x);
+}
+
+// M模式trap入口和scratch寄存器，只用于转发核间中断
+static inline void w_mtvec(uint64 x) {
+  WRITE_CSR(mtvec, x);
+}
+
+static inline void w_mscratch(uint64 x) {
+  WRITE_CSR(mscratch, x);
+}
+
+// mie寄存器：MSIE允许CLINT的机器软件中断
+#define MIE_MSIE (1L << 3)
+
+static inline uint64 r_mie() {
+  return READ_CSR(mie);
+}
+
+static inline void w_mie(uint64 x) {
+  WRITE_CSR(mie, x);
+}
+
+static inline uint64 r_mhartid() {
+  return READ_CSR(mhartid);
+}
+
+// mcounteren寄存器：允许低特权级读取计数器
+#define MCOUNTEREN_CY (1L << 0)
+#define MCOUNTEREN_TM (1L << 1)
+
+static inline uint64 r_mcounteren() {
+  return READ_CSR(mcounteren);
+}
+
+static inline void w_mcounteren(uint64 x) {
+  WRITE_CSR(mcounteren, x);
+}
+
+// scounteren寄存器：允许U模式读取计数器，位定义与mcounteren相同
+static inline uint64 r_scounteren() {
+  return READ_CSR(scounteren);
+}
+
+static inline void w_scounteren(uint64 x) {
+  WRITE_CSR(scounteren, x);
+}
+
+// menvcfg寄存器（CSR编号0x30a），STCE位启用Sstc扩展
+#define MENVCFG_STCE (1ULL << 63)
+
+static inline uint64 r_menvcfg() {
+  return READ_CSR(0x30a);
+}
+
+static inline void w_menvcfg(uint64 x) {
+  WRITE_CSR(0x30a, x);
+}
+
+// PMP配置
+static inline void w_pmpaddr0(uint64 x) {
+  WRITE_CSR(pmpaddr0, x);
+}
+
+static inline void w_pmpcfg0(uint64 x) {
+  WRITE_CSR(pmpcfg0, x);
+}
+
 #endif // _RISCV_H_
\ No newline at end of file
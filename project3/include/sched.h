@@ -0,0 +1,102 @@
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include "types.h"
+#include "proc.h"
+
+// EDF带宽使用定点数表示，1.0 = (1 << BW_SHIFT)
+#define BW_SHIFT        20
+#define BW_UNIT         (1ULL << BW_SHIFT)
+
+// EDF准入控制上限：所有EDF任务带宽之和不超过95%
+#define EDF_BW_LIMIT    (BW_UNIT * 95 / 100)
+
+// EDF周期上限（10秒）：保证runtime << BW_SHIFT和US_TO_TICKS不溢出
+#define EDF_MAX_PERIOD_US   10000000ULL
+
+// 负载均衡
+#define BALANCE_INTERVAL_US 100000  // 每个hart的周期负载均衡间隔
+#define MIGRATION_COST_US   500     // 离开CPU不到这么久的任务缓存还是热的，迁移代价高
+
+// 隔离的hart掩码，编译时通过ISOLCPUS指定（hart 0负责全局时钟和控制台，不能隔离）
+// 隔离的hart上不运行kworker，只有空闲任务时才保留周期tick，
+// 新任务默认不会调度到这些hart上，只有显式设置亲和性的任务才会在上面运行
+#ifndef ISOLCPUS_MASK
+#define ISOLCPUS_MASK   0
+#endif
+#define CPU_ISOLATED_MASK ((uint64)(ISOLCPUS_MASK) & CPU_MASK_ALL & ~1ULL)
+
+// 已完成初始化、参与调度的hart
+extern volatile uint64 cpu_online_mask;
+
+// hart id是否被隔离
+static inline int cpu_isolated(int id) {
+    return (CPU_ISOLATED_MASK >> id) & 1;
+}
+
+// 导出给用户的调度统计，布局与ulib.h中的struct sched_stat一致
+struct sched_stat {
+    uint64 policy;          // 调度类
+    uint64 nr_jobs;         // EDF已完成作业数
+    uint64 nr_misses;       // EDF错过截止时间次数
+    uint64 total_misses;    // 系统内所有EDF任务的错过次数
+    uint64 sum_exec_us;     // 累计运行时间（微秒）
+    uint64 total_bw;        // 已准入的EDF总带宽（千分比）
+    uint64 cpu;             // 当前运行的hart
+    uint64 nr_migrations;   // 被迁移到其他hart的次数
+    uint64 fpu_saves;       // 切换时保存浮点寄存器的次数
+    uint64 fpu_restores;    // 使用浮点时加载浮点寄存器的次数
+};
+
+// 初始化调度器，创建空闲任务
+void sched_init();
+
+// 开始在当前hart上运行任务t（t的上下文由调用者直接加载）
+void sched_start(struct task *t);
+
+// 加入就绪队列
+void sched_wakeup(struct task *t);
+
+// 同sched_wakeup，调用者持有sched_lock
+void sched_wakeup_locked(struct task *t);
+
+// 时钟中断中调用：唤醒睡眠任务、补充EDF预算
+void sched_tick(uint64 now);
+
+// 从trap返回前调用，regs是当前trap保存的寄存器数组；
+// 返回要恢复的寄存器数组，切换任务时是下一个任务保存的上下文
+uint64 *schedule(uint64 *regs);
+
+// 调度器下一个需要时钟中断的时间点
+uint64 sched_next_event();
+
+// 当前任务让出CPU；对EDF任务表示本周期作业完成
+void sched_yield();
+
+// 当前任务睡眠指定毫秒数
+void sched_sleep(uint64 milliseconds);
+
+// 当前任务在chan上阻塞，直到sched_wakeup_chan(chan)；与sched_sleep相同，
+// 返回用户态前被切换出去。调用者持有保护等待条件的锁，唤醒方也要先获取它
+void sched_block(void *chan);
+
+// 唤醒所有在chan上阻塞的任务，返回唤醒的数量，可以在中断上下文中调用
+int sched_wakeup_chan(void *chan);
+
+// 当前任务退出
+void sched_exit(int code);
+
+// 设置当前任务的EDF参数（微秒），runtime为0时恢复为公平调度类
+// 参数无效（周期超过EDF_MAX_PERIOD_US等）或准入失败返回-1
+int sched_setattr(uint64 runtime_us, uint64 deadline_us, uint64 period_us);
+
+// 获取当前任务的调度统计
+void sched_getstat(struct sched_stat *st);
+
+// 设置任务（pid为0表示当前任务）允许运行的hart掩码，不包含在线hart时返回-1
+int sched_setaffinity(int pid, uint64 mask);
+
+// 获取任务允许运行的在线hart掩码，任务不存在返回-1
+int sched_getaffinity(int pid, uint64 *mask);
+
+#endif // _SCHED_H_
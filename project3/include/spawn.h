@@ -0,0 +1,29 @@
+#ifndef _SPAWN_H_
+#define _SPAWN_H_
+
+#include "types.h"
+
+#define SPAWN_MAX_ACTIONS 8
+
+// spawn的文件操作，在子进程加载程序后、开始运行前按顺序执行
+enum spawn_action_type {
+    SPAWN_FA_CLOSE = 1,     // close(fd)
+    SPAWN_FA_DUP2,          // dup2(fd, newfd)
+    SPAWN_FA_OPEN,          // 打开path并放到fd上
+};
+
+struct spawn_action {
+    int type;
+    int fd;
+    int newfd;
+    int flags;
+    const char *path;
+};
+
+// 布局与用户库中的spawn_file_actions_t一致
+struct spawn_file_actions {
+    int count;
+    struct spawn_action actions[SPAWN_MAX_ACTIONS];
+};
+
+#endif // _SPAWN_H_
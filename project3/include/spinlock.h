@@ -0,0 +1,26 @@
+#ifndef _SPINLOCK_H_
+#define _SPINLOCK_H_
+
+#include "types.h"
+
+// 自旋锁：持有期间本hart关中断，避免中断处理函数在同一hart上等待自己
+struct spinlock {
+    volatile uint32 locked;
+    const char *name;       // 用于调试输出
+    int cpu;                // 持有者hart，未持有时为-1
+};
+
+#define SPINLOCK_INIT(n) { 0, (n), -1 }
+
+void spin_init(struct spinlock *lk, const char *name);
+
+// 关中断后获取锁，返回之前的中断状态，配合spin_unlock_irqrestore使用
+uint64 spin_lock_irqsave(struct spinlock *lk);
+
+// 释放锁并恢复中断状态
+void spin_unlock_irqrestore(struct spinlock *lk, uint64 flags);
+
+// 当前hart是否持有该锁
+int spin_holding(struct spinlock *lk);
+
+#endif // _SPINLOCK_H_
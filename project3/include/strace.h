@@ -0,0 +1,32 @@
+#ifndef _STRACE_H_
+#define _STRACE_H_
+
+#include "types.h"
+
+// 系统调用跟踪：被跟踪进程的每次系统调用在执行它的hart上记录一条定长
+// 二进制记录，不经过控制台。每个hart一个环形缓冲区，满了覆盖最旧的记录。
+
+#define STRACE_RING_SIZE 128    // 每个hart的记录数，2的幂
+
+// 跟踪记录 - 用户库中有相同布局的定义
+struct strace_rec {
+    uint64 enter;           // 进入和返回时的time寄存器值
+    uint64 exit;
+    uint32 pid;             // 线程ID
+    uint16 num;             // 系统调用号
+    uint16 cpu;             // 执行的hart
+    uint64 args[6];
+    uint64 ret;
+};
+
+// 打开或关闭进程pid（0表示当前进程）所有线程的跟踪，之后创建的子进程和线程继承
+int strace_ctl(int pid, int on);
+
+// 当前任务被跟踪时记录一次系统调用，由syscall()调用
+void strace_record(uint64 num, const uint64 *args, uint64 ret, uint64 enter, uint64 exit);
+
+// 取出最多max条记录复制到用户地址ubuf，按hart依次取出；
+// 被覆盖的记录数累加到*lost，返回取出的记录数
+int strace_read(uint64 ubuf, int max, uint64 *lost);
+
+#endif // _STRACE_H_
@@ -1,23 +1,42 @@
 #ifndef _SYSCALL_H_
 #define _SYSCALL_H_
 
+#ifdef __ASSEMBLER__
+
+// 汇编文件（entry.S）中的系统调用号，同样由syscall_list.h生成
+#define SYSCALL(num, name) .equ SYS_##name, num
+#include "syscall_list.h"
+#undef SYSCALL
+
+#else
+
 #include "types.h"
 
-// 系统调用号
-#define SYS_write      1
-#define SYS_exit       2
-#define SYS_getpid     3
-#define SYS_sleep      4
-#define SYS_yield      5
-#define SYS_time       6
-#define SYS_exec       7
-#define SYS_fork       8
-#define SYS_wait       9
-#define SYS_open       10
-#define SYS_close      11
-#define SYS_read       12
+// 系统调用号，由syscall_list.h生成
+enum {
+#define SYSCALL(num, name) SYS_##name = num,
+#include "syscall_list.h"
+#undef SYSCALL
+    NSYSCALL                // 最后一项的编号加一：列表按编号递增排列，允许空缺
+};
+
+// 每个系统调用的延迟直方图桶数：第i个桶统计耗时在[2^i, 2^(i+1))个cycle的调用
+#define SYSCALL_HIST_BUCKETS 32
+
+// 系统调用统计 - 用户库中有相同布局的定义
+struct syscall_stat {
+    uint64 count;                       // 调用次数
+    uint64 cycles;                      // 累计cycle数
+    uint64 hist[SYSCALL_HIST_BUCKETS];  // log2延迟直方图
+};
 
 // 处理系统调用
 uint64 syscall(uint64 syscall_num, uint64 a0, uint64 a1, uint64 a2, uint64 a3, uint64 a4, uint64 a5);
 
+// 当前系统调用在任务被唤醒后重新执行：返回时sepc退回到ecall，a0保持原来的参数。
+// 与sched_block一起使用，处理函数不能已经产生副作用
+void syscall_restart(void);
+
+#endif // __ASSEMBLER__
+
 #endif // _SYSCALL_H_
\ No newline at end of file
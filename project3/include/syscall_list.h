@@ -0,0 +1,38 @@
+// syscall_list.h - 系统调用编号表，内核（syscall.h）和用户库（ulib.h）共用
+//
+// 每项为 SYSCALL(编号, 名称)，包含本文件之前定义SYSCALL宏来生成需要的内容：
+// SYS_名称常量、内核的分发表等。新增系统调用只需在这里加一行，
+// 并在kernel/syscall.c中实现对应的处理函数。
+// 本文件会被多次包含，没有头文件保护。
+
+SYSCALL(1,  write)
+SYSCALL(2,  exit)
+SYSCALL(3,  getpid)
+SYSCALL(4,  sleep)
+SYSCALL(5,  yield)
+SYSCALL(6,  time)
+SYSCALL(7,  exec)
+SYSCALL(8,  fork)
+SYSCALL(9,  wait)
+SYSCALL(10, open)
+SYSCALL(11, close)
+SYSCALL(12, read)
+SYSCALL(13, sched_setattr)
+SYSCALL(14, sched_getstat)
+SYSCALL(15, spawn)
+SYSCALL(16, dup2)
+SYSCALL(17, clone)
+SYSCALL(18, thread_exit)
+SYSCALL(19, gettid)
+SYSCALL(20, sbrk)
+SYSCALL(21, futex)
+SYSCALL(22, sched_setaffinity)
+SYSCALL(23, sched_getaffinity)
+SYSCALL(24, syscall_stat)
+SYSCALL(25, ring_setup)
+SYSCALL(26, ring_enter)
+SYSCALL(27, strace_ctl)
+SYSCALL(28, strace_read)
+SYSCALL(29, irq_stat)
+SYSCALL(30, console_mode)
+SYSCALL(31, log_level)
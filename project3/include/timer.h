@@ -3,16 +3,29 @@
 
 #include "types.h"
 
+// timebase频率 (QEMU默认为10MHz)
+#define CLOCK_FREQ      10000000
+
+// 时钟中断频率
+#define TIMER_HZ        100
+
+// 微秒与timebase tick之间的换算
+#define US_TO_TICKS(us) ((us) * (CLOCK_FREQ / 1000000))
+#define TICKS_TO_US(t)  ((t) / (CLOCK_FREQ / 1000000))
+
 // 初始化时钟
 void timer_init();
 
 // 设置下一次时钟中断
 void timer_set_next();
 
+// 根据周期tick和调度器的下一个事件重新设置stimecmp
+void timer_reprogram();
+
 // 获取当前时间（毫秒）
 uint64 get_time_ms();
 
 // 处理时钟中断
 void timer_handler();
 
-#endif // _TIMER_H_
\ No newline at end of file
+#endif // _TIMER_H_
@@ -3,10 +3,51 @@
 
 #include "types.h"
 
-// 初始化中断处理
+struct task;
+
+// trap_vector保存的寄存器数组下标
+#define REG_RA   0
+#define REG_SP   1
+#define REG_GP   2
+#define REG_TP   3
+#define REG_A0   9
+#define REG_A1   10
+#define REG_A2   11
+#define REG_A3   12
+#define REG_A4   13
+#define REG_A5   14
+#define REG_A7   16
+
+// 初始化当前hart的中断处理
 void trap_init();
 
-// 中断处理函数
-void trap_handler();
+// 关中断并返回之前的中断状态；最外层的关中断区间会计入关中断时间统计
+uint64 irq_save();
+
+// 恢复irq_save之前的中断状态
+void irq_restore(uint64 flags);
+
+// 当前hart是否在trap处理中（中断上下文）
+int in_interrupt();
+
+// 获取hart的最长关中断时间（timebase tick）及发生位置
+uint64 irqoff_max(int hart, const char **where);
+
+// 中断处理函数，返回要恢复的寄存器数组
+uint64 *trap_handler();
+
+// 系统调用和中断的快速路径，返回非0时entry.S补存s0-s11并调用trap_exit_slow
+uint64 syscall_fast(uint64 *regs);
+uint64 intr_fast(uint64 *regs, uint64 cause);
+uint64 *trap_exit_slow(uint64 *regs);
+
+// 本hart的内核trap栈顶，处理来自U模式的trap时使用
+uint64 trap_stack_top();
+
+// 即将返回U模式：把sscratch指向任务的trap帧，并记录本hart的内核栈和ID
+void trap_prepare_user(struct task *t);
+
+// 从frame指向的寄存器数组恢复上下文并sret（entry.S）
+void trap_return(uint64 *frame) __attribute__((noreturn));
 
-#endif // _TRAP_H_
\ No newline at end of file
+#endif // _TRAP_H_
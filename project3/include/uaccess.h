@@ -0,0 +1,32 @@
+#ifndef _UACCESS_H_
+#define _UACCESS_H_
+
+#include "types.h"
+
+// 在系统调用中访问当前地址空间的用户内存
+//
+// 每次调用只检查一次地址范围，然后在内核中直接（SUM=1）按8字节复制。
+// 复制例程中每条访问用户内存的指令都登记在__ex_table中：访问未映射或
+// 不可写的页时，页错误处理不挂起系统，而是跳到修复代码返回错误。
+
+// 异常表项：faulting指令地址和修复代码地址，由uaccess.S生成
+struct exception_entry {
+    uint64 insn;
+    uint64 fixup;
+};
+
+// [uaddr, uaddr+n)完全位于用户地址空间内
+int access_ok(uint64 uaddr, uint64 n);
+
+// 成功返回0，地址越界或访问出错返回-1（可能已经复制了一部分）
+int copy_from_user(void *dst, uint64 usrc, uint64 n);
+int copy_to_user(uint64 udst, const void *src, uint64 n);
+
+// 复制以'\0'结尾的用户字符串（路径、参数）到dst，最多n字节（包括'\0'）
+// 返回字符串长度；地址越界、访问出错或n字节内没有结尾返回-1
+int64 strncpy_from_user(char *dst, uint64 usrc, uint64 n);
+
+// S模式的页错误：faulting指令在异常表中时把sepc改为修复代码并返回1
+int uaccess_fixup(uint64 sepc);
+
+#endif // _UACCESS_H_
@@ -3,16 +3,33 @@
 
 #include "types.h"
 
+// 发送缓冲区大小，2的幂
+#define UART_TX_SIZE 4096
+
 // 初始化UART设备
 void uart_init();
 
-// 向UART发送一个字符
+// 注册串口中断并启用收发中断，之后输出写入发送缓冲区；注册失败返回-1，
+// 仍然轮询发送（PLIC初始化之后调用）
+int uart_intr_enable();
+
+// 向UART发送一个字符，写入发送缓冲区后立即返回
 void uart_putc(char c);
 
+// 发送缓冲区空间不足need字节时返回1，nonblock为0则当前任务阻塞；
+// 空间足够或还没有启用中断时返回0
+int uart_tx_wait(uint64 need, int nonblock);
+
+// 轮询发送缓冲区中剩余的数据，用于系统挂起之前
+void uart_flush();
+
+// 写入串口的字节数和输出花费的时间（timebase tick）
+void uart_stat(uint64 *bytes, uint64 *busy);
+
 // 从UART读取一个字符（如果有）
 int uart_getc();
 
 // 检查UART是否有数据可读
 int uart_has_data();
 
-#endif // _UART_H_
\ No newline at end of file
+#endif // _UART_H_
@@ -8,6 +8,9 @@
 void* memset(void* dst, int c, size_t n);
 void* memcpy(void* dst, const void* src, size_t n);
 
+/* 字符串操作 */
+int strcmp(const char* a, const char* b);
+
 /* 磁盘操作 */
 void disk_read(void* dst, uint32 offset, uint32 count);
 
@@ -0,0 +1,40 @@
+#ifndef _VDSO_H_
+#define _VDSO_H_
+
+#include "types.h"
+#include "vm.h"
+
+// 映射到每个进程的只读数据页，用户库不经过ecall读取时间和pid
+// 布局与用户库（ulib.h）中的定义一致
+
+// 时间页（USER_VDATA），所有进程共享同一物理页
+// 用户态时间 = (rdtime - offset) / freq，offset和freq由序号（seqlock）保护：
+// 写者更新前后各把seq加一，读者看到奇数或前后seq不同时重读
+struct vdso_time {
+    volatile uint32 seq;
+    uint32 pad;
+    volatile uint64 freq;       // time寄存器频率（Hz）
+    volatile uint64 offset;     // 时间零点对应的time寄存器值
+};
+
+// 进程页（USER_VDATA + PGSIZE），每个地址空间一页
+struct vdso_proc {
+    uint64 pid;                 // 进程ID（tgid），同一进程的线程共享
+};
+
+// 初始化时间页，时间零点为调用时刻（hart 0启动时调用一次）
+void vdso_init();
+
+// 修改时间零点
+void vdso_set_clock(uint64 offset);
+
+// 内核读取时间零点
+uint64 vdso_clock_offset();
+
+// 把时间页和新的进程页映射到用户页表
+int vdso_map(pagetable_t pagetable, int pid);
+
+// 更新进程页中的pid（fork复制了父进程的进程页）
+void vdso_set_pid(pagetable_t pagetable, int pid);
+
+#endif // _VDSO_H_
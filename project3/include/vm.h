@@ -0,0 +1,66 @@
+#ifndef _VM_H_
+#define _VM_H_
+
+#include "types.h"
+#include "kalloc.h"
+
+typedef uint64 pte_t;
+typedef uint64 *pagetable_t;   // 512个PTE
+
+// 页表项标志位
+#define PTE_V (1L << 0)
+#define PTE_R (1L << 1)
+#define PTE_W (1L << 2)
+#define PTE_X (1L << 3)
+#define PTE_U (1L << 4)
+#define PTE_G (1L << 5)
+#define PTE_A (1L << 6)
+#define PTE_D (1L << 7)
+#define PTE_NOFREE (1L << 8)   // RSW位：页不属于该地址空间，释放时跳过
+
+#define PA2PTE(pa)    ((((uint64)(pa)) >> 12) << 10)
+#define PTE2PA(pte)   (((pte) >> 10) << 12)
+#define PTE_FLAGS(pte) ((pte) & 0x3FF)
+
+// 虚拟地址中第level级页表的索引
+#define PXSHIFT(level) (PGSHIFT + 9 * (level))
+#define PX(level, va)  ((((uint64)(va)) >> PXSHIFT(level)) & 0x1FF)
+
+// Sv39模式
+#define SATP_SV39     (8L << 60)
+#define MAKE_SATP(pt) (SATP_SV39 | (((uint64)(pt)) >> 12))
+
+// 内核页表：设备和物理内存各用一个1GB大页恒等映射
+extern pagetable_t kernel_pagetable;
+
+// 创建内核页表
+void kvminit();
+
+// 在当前hart上启用分页
+void kvminithart();
+
+// 切换到指定页表（与当前相同时不刷新TLB）
+void vm_switch(pagetable_t pagetable);
+
+// 查找va对应的最后一级PTE，alloc非0时分配中间页表
+pte_t *walk(pagetable_t pagetable, uint64 va, int alloc);
+
+// 查找用户虚拟地址对应的物理地址，未映射返回0
+uint64 walkaddr(pagetable_t pagetable, uint64 va);
+
+// 建立[va, va+size)到pa的映射
+int mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm);
+
+// 创建只包含内核映射的用户页表
+pagetable_t uvmcreate();
+
+// 释放用户页表及其拥有的所有物理页
+void uvmfree(pagetable_t pagetable);
+
+// 复制用户地址空间：私有页复制内容，PTE_NOFREE页共享同一物理页
+int uvmcopy(pagetable_t old, pagetable_t new);
+
+// 把内核数据复制到指定页表中的用户地址
+int copyout(pagetable_t pagetable, uint64 dstva, const void *src, uint64 len);
+
+#endif // _VM_H_
@@ -0,0 +1,34 @@
+#ifndef _WORKQUEUE_H_
+#define _WORKQUEUE_H_
+
+#include "types.h"
+
+// 延迟执行的工作项，由调用者嵌入到自己的数据结构中
+struct work {
+    void (*fn)(struct work *w);
+    struct work *next;
+    int pending;            // 已在队列中，避免重复加入
+};
+
+#define INIT_WORK(w, f) do { (w)->fn = (f); (w)->next = NULL; (w)->pending = 0; } while (0)
+
+// 软中断向量
+enum {
+    SOFTIRQ_TIMER,          // 时钟中断下半部
+    SOFTIRQ_LOG,            // 输出日志缓冲区（klog.c）
+    NR_SOFTIRQS,
+};
+
+// 初始化当前hart的工作队列并创建kworker线程
+void workqueue_init();
+
+// 把工作项加入当前hart的队列（可在中断上下文调用）
+void queue_work(struct work *w);
+
+// 注册软中断处理函数
+void open_softirq(int nr, void (*fn)(void));
+
+// 触发软中断（可在中断上下文调用）
+void raise_softirq(int nr);
+
+#endif // _WORKQUEUE_H_
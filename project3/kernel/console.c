@@ -1,30 +1,137 @@
 #include "../include/console.h"
 #include "../include/uart.h"
 #include "../include/types.h"
+#include "../include/trap.h"
+#include "../include/klog.h"
+#include "../include/util.h"
+#include "../include/printf.h"
+#include "../include/spinlock.h"
+#include "../include/uaccess.h"
+#include "../include/sched.h"
+#include "../include/syscall.h"
+
+// 控制台锁：多个hart同时输出时保证一条消息不被打断
+// 同一hart可以嵌套获取（日志模块先输出前缀再输出内容，panic可能发生在输出过程中）
+static struct spinlock cons_lock = SPINLOCK_INIT("console");
+static int cons_depth;
+
+static uint64 console_lock(void) {
+    if (spin_holding(&cons_lock)) {
+        cons_depth++;
+        return 0;
+    }
+    return spin_lock_irqsave(&cons_lock);
+}
+
+static void console_unlock(uint64 flags) {
+    if (cons_depth > 0) {
+        cons_depth--;
+        return;
+    }
+    spin_unlock_irqrestore(&cons_lock, flags);
+}
 
 /* ========== 日志模块实现 ========== */
-#define IMPLEMENT_LOG_MODULE(name, prefix, enabled) \
+// 各模块启动时的级别，运行时用系统调用log_level修改
+int log_levels[NLOG_MODULES] = {
+    [LOG_MOD_MAIN] = LOG_OFF,
+    [LOG_MOD_TRAP] = LOG_INFO,
+    [LOG_MOD_SYSCALL] = LOG_OFF,
+    [LOG_MOD_TIMER] = LOG_OFF,
+    [LOG_MOD_PAGE] = LOG_OFF,
+    [LOG_MOD_QEMU] = LOG_OFF,
+    [LOG_MOD_PROC] = LOG_OFF,
+    [LOG_MOD_SCHED] = LOG_OFF,
+};
+
+static const char *const log_names[NLOG_MODULES] = {
+#define LOG_MODULE_NAME(name) [LOG_MOD_##name] = #name,
+    LOG_MODULES(LOG_MODULE_NAME)
+#undef LOG_MODULE_NAME
+};
+
+// 日志前缀，二进制跟踪模式下也放入.klog_fmt段
+#if KLOG_BINARY
+#define LOG_MODULE_PREFIX(name) \
+    static const char klog_prefix_##name[] __attribute__((section(".klog_fmt"), used)) = "[" #name "] ";
+LOG_MODULES(LOG_MODULE_PREFIX)
+#undef LOG_MODULE_PREFIX
+#define LOG_MODULE_PREFIX(name) [LOG_MOD_##name] = klog_prefix_##name,
+#else
+#define LOG_MODULE_PREFIX(name) [LOG_MOD_##name] = "[" #name "] ",
+#endif
+static const char *const log_prefixes[NLOG_MODULES] = {
+    LOG_MODULES(LOG_MODULE_PREFIX)
+};
+#undef LOG_MODULE_PREFIX
+
+// 只把格式串和参数写入本hart的日志缓冲区，由kworker格式化输出（klog.c），
+// 热路径中的日志不等待串口
+#if KLOG_BINARY
+void klog_trace(int mod, struct klog_ratelimit *rl, const char *fmt, int nargs, uint32 strmask, ...) {
+    va_list args;
+    va_start(args, strmask);
+    klog_write_trace(log_prefixes[mod], fmt, rl, nargs, strmask, args);
+    va_end(args);
+}
+#else
+void console_log(int mod, struct klog_ratelimit *rl, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    klog_write(log_prefixes[mod], fmt, rl, args);
+    va_end(args);
+}
+#endif
+
+static const char *const log_level_names[] = { "off", "info", "debug" };
+
+int console_set_log_level(const char *name, int level) {
+    if (level > LOG_DEBUG) {
+        return -1;
+    }
+    for (int i = 0; i < NLOG_MODULES; i++) {
+        if (strcmp(name, log_names[i]) != 0) {
+            continue;
+        }
+        int old = log_levels[i];
+        if (level >= 0) {
+            log_levels[i] = level;
+            console_printf("[LOG] %s: %s -> %s\n", log_names[i],
+                           log_level_names[old], log_level_names[level]);
+        }
+        return old;
+    }
+    return -1;
+}
+
+void console_print_log_levels() {
+    uint64 flags = console_lock();
+    console_printf("日志级别:");
+    for (int i = 0; i < NLOG_MODULES; i++) {
+        console_printf(" %s=%s", log_names[i], log_level_names[log_levels[i]]);
+    }
+    console_printf("\n");
+    console_unlock(flags);
+}
+
+// 同步输出的日志模块，用于系统即将挂起、kworker无法再运行的场合
+#define IMPLEMENT_SYNC_LOG_MODULE(name, prefix, enabled) \
     void console_printf_##name(const char *fmt, ...) { \
         if (enabled) { \
             va_list args; \
             va_start(args, fmt); \
+            uint64 flags = console_lock(); \
             console_printf("%s", prefix); \
             console_vprintf(fmt, args); \
+            console_unlock(flags); \
+            console_flush(); \
             va_end(args); \
         } \
     }
 
-// 实际模块配置
-IMPLEMENT_LOG_MODULE(MAIN, "[MAIN] ", 0)
-IMPLEMENT_LOG_MODULE(TRAP, "[TRAP] ", 1)
-IMPLEMENT_LOG_MODULE(SYSCALL, "[SYSCALL] ", 0)
-IMPLEMENT_LOG_MODULE(TIMER, "[TIMER] ", 0)
-IMPLEMENT_LOG_MODULE(PAGE, "[PAGE] ", 0)
-IMPLEMENT_LOG_MODULE(QEMU, "[QEMU] ", 0)
-IMPLEMENT_LOG_MODULE(PANIC, "[PANIC] ", 1)
-
+IMPLEMENT_SYNC_LOG_MODULE(PANIC, "[PANIC] ", 1)
 
-#undef IMPLEMENT_LOG_MODULE
+#undef IMPLEMENT_SYNC_LOG_MODULE
 
 // 初始化控制台
 void console_init() {
@@ -49,300 +156,214 @@ void console_puts(const char *s) {
     }
 }
 
-// 从控制台读取一个字符（如果有）
-int console_getc() {
-    return uart_getc();
+// 向控制台输出一段数据，不与其他hart的输出交错
+void console_write(const char *buf, uint64 n) {
+    uint64 flags = console_lock();
+    for (uint64 i = 0; i < n; i++) {
+        console_putc(buf[i]);
+    }
+    console_unlock(flags);
 }
 
-// 将整数转换为字符串
-static char* itoa(int value, char* result, int base) {
-    // 检查base是否支持
-    if (base < 2 || base > 36) {
-        *result = '\0';
-        return result;
+void console_write_raw(const char *buf, uint64 n) {
+    uint64 flags = console_lock();
+    for (uint64 i = 0; i < n; i++) {
+        uart_putc(buf[i]);
     }
+    console_unlock(flags);
+}
 
-    char* ptr = result, *ptr1 = result;
-    char tmp_char;
-    int tmp_value;
-
-    // 处理负数
-    if (value < 0 && base == 10) {
-        *ptr++ = '-';
-        value = -value;
-    }
+// 输出用户缓冲区中的数据：分块复制到内核后写入串口发送缓冲区，不与其他hart的输出交错。
+// 发送缓冲区放不下时任务阻塞（nonblock为1时不阻塞），先返回已经输出的字节数（可能为0），
+// 用户库在唤醒后继续写剩余部分。一个字节都没有输出且地址无效时返回-1
+int console_write_user(uint64 ubuf, uint64 n, int nonblock) {
+    char buf[128];
+    uint64 done = 0;
+    int fault = 0;
+    uint64 flags = console_lock();
 
-    // 处理0
-    if (value == 0) {
-        *ptr++ = '0';
-        *ptr = '\0';
-        return result;
+    while (done < n) {
+        uint64 m = n - done < sizeof(buf) ? n - done : sizeof(buf);
+        // 换行展开为\r\n，最坏情况每个字节占两个位置
+        if (uart_tx_wait(2 * m, nonblock)) {
+            break;
+        }
+        if (copy_from_user(buf, ubuf + done, m) < 0) {
+            fault = 1;
+            break;
+        }
+        for (uint64 i = 0; i < m; i++) {
+            console_putc(buf[i]);
+        }
+        done += m;
     }
+    console_unlock(flags);
+    return done == 0 && fault ? -1 : (int)done;
+}
 
-    // 转换整数为字符串
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
-    } while (value);
+// 等待发送缓冲区中的输出全部写入串口，用于系统挂起之前
+void console_flush() {
+    uart_flush();
+}
 
-    // 添加字符串结束符
-    *ptr-- = '\0';
+/* ========== 控制台输入 ========== */
+#define CONS_IN_SIZE 4096           // 输入缓冲区大小，2的幂
+#define CTRL(x) ((x) - '@')
 
-    // 反转字符串
-    if (*result == '-') {
-        ptr1++;
-    }
-    while (ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
-    }
+// 串口接收中断写入，读者从r读到w；规范模式下[w, e)是正在编辑、还不能读取的行
+// 锁顺序：cons_in.lock -> uart_tx.lock（回显）、sched_lock（唤醒和阻塞读者）
+static struct {
+    struct spinlock lock;
+    char buf[CONS_IN_SIZE];
+    uint64 r;               // 下一个读取位置
+    uint64 w;               // 可以读取的数据的末尾
+    uint64 e;               // 正在编辑的行的末尾
+    int mode;               // CONSOLE_CANON或CONSOLE_RAW
+    uint64 dropped;         // 缓冲区满时丢弃的字符数
+} cons_in = { .lock = SPINLOCK_INIT("console_in") };
 
-    return result;
+// 把正在编辑的内容变为可读，唤醒阻塞的读者
+static void cons_in_commit() {
+    cons_in.w = cons_in.e;
+    sched_wakeup_chan(&cons_in);
 }
 
-// 将长整数转换为字符串
-static char* ltoa(unsigned long value, char* result, int base) {
-    // 检查base是否支持
-    if (base < 2 || base > 36) {
-        *result = '\0';
-        return result;
-    }
-
-    char* ptr = result, *ptr1 = result;
-    char tmp_char;
-    unsigned long tmp_value;
+void console_rx(int c) {
+    uint64 flags = spin_lock_irqsave(&cons_in.lock);
 
-    // 处理0
-    if (value == 0) {
-        *ptr++ = '0';
-        *ptr = '\0';
-        return result;
-    }
-
-    // 转换整数为字符串
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
-    } while (value);
-
-    // 添加字符串结束符
-    *ptr-- = '\0';
-
-    // 反转字符串
-    while (ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
+    if (cons_in.mode == CONSOLE_RAW) {
+        if (cons_in.e - cons_in.r < CONS_IN_SIZE) {
+            cons_in.buf[cons_in.e++ % CONS_IN_SIZE] = c;
+            cons_in_commit();
+        } else {
+            cons_in.dropped++;
+        }
+        spin_unlock_irqrestore(&cons_in.lock, flags);
+        return;
     }
 
-    return result;
-}
-
-int console_vprintf(const char *fmt, va_list args) {
-    char c;
-    int count = 0;
-    char buf[24];
-    
-    while ((c = *fmt++)) {
-        if (c != '%') {
-            console_putc(c);
-            count++;
-            continue;
-        }
-        
-        // 处理格式说明符
-        c = *fmt++;
-        if (!c) break;
-        
-        // 处理宽度和填充
-        int width = 0;
-        int zero_padding = 0;
-        
-        if (c == '0') {
-            zero_padding = 1;
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        // 解析宽度
-        while (c >= '0' && c <= '9') {
-            width = width * 10 + (c - '0');
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        // 检查长整数标志
-        int is_long = 0;
-        if (c == 'l') {
-            is_long = 1;
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        switch (c) {
-            case 'c': {
-                // 字符
-                char ch = (char)va_arg(args, int);
-                console_putc(ch);
-                count++;
-                break;
+    switch (c) {
+        case CTRL('U'):     // 删除正在编辑的整行
+            while (cons_in.e != cons_in.w) {
+                cons_in.e--;
+                console_puts("\b \b");
             }
-            
-            case 's': {
-                // 字符串
-                char* s = va_arg(args, char*);
-                if (!s) s = "(null)";
-                
-                // 计算字符串长度
-                int len = 0;
-                char* p = s;
-                while (*p++) len++;
-                
-                // 处理宽度填充
-                if (width > len && !zero_padding) {
-                    for (int i = 0; i < width - len; i++) {
-                        console_putc(' ');
-                        count++;
-                    }
-                }
-                
-                // 输出字符串
-                while (*s) {
-                    console_putc(*s++);
-                    count++;
-                }
-                break;
+            break;
+        case '\b':
+        case 0x7f:          // 退格
+            if (cons_in.e != cons_in.w) {
+                cons_in.e--;
+                console_puts("\b \b");
             }
-            
-            case 'd': {
-                // 有符号十进制整数
-                if (is_long) {
-                    long value = va_arg(args, long);
-                    if (value < 0) {
-                        console_putc('-');
-                        count++;
-                        value = -value;
-                    }
-                    ltoa(value, buf, 10);
-                } else {
-                    int value = va_arg(args, int);
-                    itoa(value, buf, 10);
-                }
-                
-                // 计算数字长度
-                int len = 0;
-                char* p = buf;
-                while (*p++) len++;
-                
-                // 处理零填充
-                if (width > len && zero_padding) {
-                    for (int i = 0; i < width - len; i++) {
-                        console_putc('0');
-                        count++;
-                    }
-                }
-                
-                // 输出数字
-                p = buf;
-                while (*p) {
-                    console_putc(*p++);
-                    count++;
-                }
-                break;
+            break;
+        default:
+            if (c == '\r') {
+                c = '\n';
             }
-            
-            case 'x': {
-                // 十六进制整数
-                if (is_long) {
-                    unsigned long value = va_arg(args, unsigned long);
-                    ltoa(value, buf, 16);
-                } else {
-                    unsigned int value = va_arg(args, unsigned int);
-                    itoa(value, buf, 16);
-                }
-                
-                // 计算数字长度
-                int len = 0;
-                char* p = buf;
-                while (*p++) len++;
-                
-                // 处理零填充
-                if (width > len && zero_padding) {
-                    for (int i = 0; i < width - len; i++) {
-                        console_putc('0');
-                        count++;
-                    }
-                }
-                
-                // 输出数字
-                p = buf;
-                while (*p) {
-                    console_putc(*p++);
-                    count++;
-                }
+            if (cons_in.e - cons_in.r >= CONS_IN_SIZE) {
+                cons_in.dropped++;
                 break;
             }
-            
-            case 'p': {
-                // 指针（十六进制）
-                unsigned long value = (unsigned long)va_arg(args, void*);
-                console_putc('0');
-                console_putc('x');
-                ltoa(value, buf, 16);
-                
-                // 计算数字长度
-                int len = 0;
-                char* p = buf;
-                while (*p++) len++;
-                
-                // 处理零填充
-                if (width > len && zero_padding) {
-                    for (int i = 0; i < width - len; i++) {
-                        console_putc('0');
-                        count++;
-                    }
-                }
-                
-                // 输出数字
-                p = buf;
-                while (*p) {
-                    console_putc(*p++);
-                    count++;
+            cons_in.buf[cons_in.e++ % CONS_IN_SIZE] = c;
+            if (c != CTRL('D')) {
+                console_putc(c);
+            }
+            // 行尾、文件结束或缓冲区已满：整行交给读者
+            if (c == '\n' || c == CTRL('D') || cons_in.e - cons_in.r == CONS_IN_SIZE) {
+                cons_in_commit();
+            }
+            break;
+    }
+    spin_unlock_irqrestore(&cons_in.lock, flags);
+}
+
+int console_read_user(uint64 ubuf, uint64 n, int nonblock) {
+    char buf[128];
+    uint64 done = 0;
+
+    while (done < n) {
+        uint64 flags = spin_lock_irqsave(&cons_in.lock);
+        if (cons_in.r == cons_in.w) {
+            if (done == 0) {
+                if (nonblock) {
+                    spin_unlock_irqrestore(&cons_in.lock, flags);
+                    return -1;
                 }
-                count += 2; // 为"0x"前缀
-                break;
+                // 持有cons_in.lock时阻塞：console_rx获取同一把锁之后才唤醒
+                sched_block(&cons_in);
+                syscall_restart();
             }
-            
-            case '%': {
-                // 百分号
-                console_putc('%');
-                count++;
+            spin_unlock_irqrestore(&cons_in.lock, flags);
+            break;
+        }
+
+        uint64 m = 0;
+        int eol = 0;
+        while (m < sizeof(buf) && done + m < n && cons_in.r != cons_in.w) {
+            char c = cons_in.buf[cons_in.r % CONS_IN_SIZE];
+            if (cons_in.mode == CONSOLE_CANON && c == CTRL('D')) {
+                // 文件结束：行首的^D被取走并使read返回0，否则留给下一次read
+                if (done + m == 0) {
+                    cons_in.r++;
+                }
+                eol = 1;
                 break;
             }
-            
-            default: {
-                // 未知格式，输出原样
-                console_putc('%');
-                if (zero_padding) console_putc('0');
-                if (width > 0) {
-                    char width_buf[8];
-                    itoa(width, width_buf, 10);
-                    char* p = width_buf;
-                    while (*p) {
-                        console_putc(*p++);
-                    }
-                }
-                if (is_long) console_putc('l');
-                console_putc(c);
-                count += 2;
+            buf[m++] = c;
+            cons_in.r++;
+            if (cons_in.mode == CONSOLE_CANON && c == '\n') {
+                eol = 1;
                 break;
             }
         }
+        spin_unlock_irqrestore(&cons_in.lock, flags);
+
+        // 已经从缓冲区取走的数据复制失败时丢失，与读到无效地址的其他文件一样返回错误
+        if (copy_to_user(ubuf + done, buf, m) < 0) {
+            return done ? (int)done : -1;
+        }
+        done += m;
+        if (eol) {
+            break;
+        }
     }
-    
+    return (int)done;
+}
+
+int console_set_mode(int mode) {
+    uint64 flags = spin_lock_irqsave(&cons_in.lock);
+    int old = cons_in.mode;
+
+    if (mode == CONSOLE_CANON || mode == CONSOLE_RAW) {
+        cons_in.mode = mode;
+        // 切换到原始模式时，正在编辑的内容直接变为可读
+        if (mode == CONSOLE_RAW && cons_in.e != cons_in.w) {
+            cons_in_commit();
+        }
+    }
+    spin_unlock_irqrestore(&cons_in.lock, flags);
+    return old;
+}
+
+// 从控制台读取一个字符（如果有）
+int console_getc() {
+    return uart_getc();
+}
+
+// 格式化缓冲区满时输出到串口，调用者持有控制台锁
+static void console_pb_flush(struct printbuf *pb) {
+    for (size_t i = 0; i < pb->len; i++) {
+        console_putc(pb->buf[i]);
+    }
+    pb->len = 0;
+}
+
+int console_vprintf(const char *fmt, va_list args) {
+    char buf[128];
+    struct printbuf pb = PRINTBUF_INIT(buf, sizeof(buf), console_pb_flush, NULL);
+    uint64 flags = console_lock();
+    int count = vbprintf(&pb, fmt, args);
+    console_unlock(flags);
     return count;
 }
 
@@ -0,0 +1,258 @@
+// exec.c - 从initramfs加载ELF用户程序
+//
+// 只读段中完整落在文件数据内、且在归档中按页对齐的页直接映射到
+// initramfs所在的物理页（PTE_NOFREE），其余页分配新页并复制。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/memlayout.h"
+#include "../include/elf.h"
+#include "../include/kalloc.h"
+#include "../include/vm.h"
+#include "../include/proc.h"
+#include "../include/trap.h"
+#include "../include/initrd.h"
+#include "../include/exec.h"
+#include "../include/util.h"
+#include "../include/console.h"
+#include "../include/vdso.h"
+#include "../include/uaccess.h"
+
+// 统计加载方式，便于确认映射是否生效
+static uint64 pages_mapped;
+static uint64 pages_copied;
+
+// 加载一个PT_LOAD段
+static int loadseg(pagetable_t pt, const uint8 *file, struct proghdr *ph) {
+    int perm = PTE_U;
+    if (ph->flags & ELF_PROG_FLAG_READ)  perm |= PTE_R;
+    if (ph->flags & ELF_PROG_FLAG_WRITE) perm |= PTE_W;
+    if (ph->flags & ELF_PROG_FLAG_EXEC)  perm |= PTE_X;
+
+    uint64 seg_end = ph->vaddr + ph->memsz;
+    uint64 file_end = ph->vaddr + ph->filesz;
+
+    for (uint64 va = PGROUNDDOWN(ph->vaddr); va < seg_end; va += PGSIZE) {
+        pte_t *pte = walk(pt, va, 0);
+        if (pte && (*pte & PTE_V)) {
+            console_printf_PROC("exec: 段在0x%lx处重叠\n", va);
+            return -1;
+        }
+
+        // 该页对应的文件数据
+        const uint8 *src = file + ph->offset + (va - ph->vaddr);
+
+        // 只读且整页都来自文件：直接映射initramfs中的物理页
+        if (!(ph->flags & ELF_PROG_FLAG_WRITE) && va >= ph->vaddr &&
+            va + PGSIZE <= file_end && ((uint64)src % PGSIZE) == 0) {
+            if (mappages(pt, va, PGSIZE, (uint64)src, perm | PTE_NOFREE) < 0) {
+                return -1;
+            }
+            pages_mapped++;
+            continue;
+        }
+
+        // 否则分配新页，复制文件中的部分，其余保持为0（.bss）
+        uint8 *page = kalloc_zeroed();
+        if (!page) {
+            return -1;
+        }
+        uint64 lo = va < ph->vaddr ? ph->vaddr : va;
+        uint64 hi = va + PGSIZE < file_end ? va + PGSIZE : file_end;
+        if (hi > lo) {
+            memcpy(page + (lo - va), file + ph->offset + (lo - ph->vaddr), hi - lo);
+        }
+        if (mappages(pt, va, PGSIZE, (uint64)page, perm) < 0) {
+            kfree(page);
+            return -1;
+        }
+        pages_copied++;
+    }
+    return 0;
+}
+
+// 计算字符串长度，超过上限返回-1
+static int arg_strlen(const char *s) {
+    for (int i = 0; i < MAXARGLEN; i++) {
+        if (s[i] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 把字符串数组压入新程序的栈，返回数组在用户空间的地址
+// user为1时数组和字符串都在当前地址空间的用户内存中，逐项复制到内核之后再使用
+static int push_strings(pagetable_t pt, uint64 *sp, char *const strs[], int user,
+                        uint64 *uptrs, int *count) {
+    char buf[MAXARGLEN];
+    int n = 0;
+
+    for (; strs; n++) {
+        const char *s;
+        int64 len;
+        if (user) {
+            uint64 us;
+            if (copy_from_user(&us, (uint64)&strs[n], sizeof(us)) < 0) {
+                return -1;
+            }
+            if (!us) {
+                break;
+            }
+            if (n >= MAXARG || (len = strncpy_from_user(buf, us, MAXARGLEN)) < 0) {
+                return -1;
+            }
+            s = buf;
+        } else {
+            if (!strs[n]) {
+                break;
+            }
+            if (n >= MAXARG || (len = arg_strlen(strs[n])) < 0) {
+                return -1;
+            }
+            s = strs[n];
+        }
+        *sp -= len + 1;
+        if (*sp < USER_STACK_BOTTOM || copyout(pt, *sp, s, len + 1) < 0) {
+            return -1;
+        }
+        uptrs[n] = *sp;
+    }
+    uptrs[n] = 0;
+    *count = n;
+    return 0;
+}
+
+// 压入指针数组
+static int push_array(pagetable_t pt, uint64 *sp, uint64 *uptrs, int n) {
+    *sp -= (n + 1) * sizeof(uint64);
+    *sp &= ~15ULL;
+    if (*sp < USER_STACK_BOTTOM || copyout(pt, *sp, uptrs, (n + 1) * sizeof(uint64)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int exec_load(struct task *t, const char *path, char *const argv[], char *const envp[], int user) {
+    const uint8 *file;
+    uint64 size;
+    struct elfhdr elf;
+    struct proghdr ph;
+    pagetable_t pt = NULL;
+    struct mm *mm;
+    uint64 brk = USER_BASE;
+    uint64 argv_uptrs[MAXARG + 1];
+    uint64 envp_uptrs[MAXARG + 1];
+    int argc, envc;
+
+    if (initrd_lookup(path, &file, &size) < 0) {
+        console_printf_PROC("exec: 找不到 %s\n", path);
+        return -1;
+    }
+
+    if (size < sizeof(elf)) {
+        goto bad;
+    }
+    memcpy(&elf, file, sizeof(elf));
+    if (elf.magic != ELF_MAGIC || elf.machine != ELF_MACHINE_RISCV ||
+        elf.phentsize != sizeof(ph) || elf.phoff + elf.phnum * sizeof(ph) > size) {
+        goto bad;
+    }
+
+    pt = uvmcreate();
+    if (!pt) {
+        goto bad;
+    }
+
+    // 加载所有PT_LOAD段
+    for (int i = 0; i < elf.phnum; i++) {
+        memcpy(&ph, file + elf.phoff + i * sizeof(ph), sizeof(ph));
+        if (ph.type != ELF_PROG_LOAD || ph.memsz == 0) {
+            continue;
+        }
+        if (ph.memsz < ph.filesz || ph.offset + ph.filesz > size ||
+            ph.vaddr < USER_BASE || ph.vaddr + ph.memsz < ph.vaddr ||
+            ph.vaddr + ph.memsz > USER_HEAP_LIMIT) {
+            goto bad;
+        }
+        if (loadseg(pt, file, &ph) < 0) {
+            goto bad;
+        }
+        if (PGROUNDUP(ph.vaddr + ph.memsz) > brk) {
+            brk = PGROUNDUP(ph.vaddr + ph.memsz);
+        }
+    }
+
+    // 用户栈
+    for (uint64 va = USER_STACK_BOTTOM; va < USER_STACK_TOP; va += PGSIZE) {
+        void *page = kalloc_zeroed();
+        if (!page) {
+            goto bad;
+        }
+        if (mappages(pt, va, PGSIZE, (uint64)page, PTE_U | PTE_R | PTE_W) < 0) {
+            kfree(page);
+            goto bad;
+        }
+    }
+
+    // 只读数据页：用户库从这里读取时间和pid
+    if (vdso_map(pt, t->tgid) < 0) {
+        goto bad;
+    }
+
+    // 参数字符串和指针数组：[envp字符串][argv字符串][envp[]][argv[]] <- sp
+    uint64 sp = USER_STACK_TOP;
+    if (push_strings(pt, &sp, envp, user, envp_uptrs, &envc) < 0 ||
+        push_strings(pt, &sp, argv, user, argv_uptrs, &argc) < 0) {
+        goto bad;
+    }
+    if (push_array(pt, &sp, envp_uptrs, envc) < 0) {
+        goto bad;
+    }
+    uint64 uenvp = sp;
+    if (push_array(pt, &sp, argv_uptrs, argc) < 0) {
+        goto bad;
+    }
+
+    // 堆从最后一个段之后开始
+    mm = mm_create(pt);
+    if (!mm) {
+        goto bad;
+    }
+    mm->brk = brk;
+
+    // 提交：替换地址空间和上下文，tp由用户库设置为主线程的TLS
+    t->mm = mm;
+    memset(t->tf.regs, 0, sizeof(t->tf.regs));
+    t->tf.regs[REG_SP] = sp;
+    t->tf.regs[REG_A0] = argc;
+    t->tf.regs[REG_A1] = sp;
+    t->tf.regs[REG_A2] = uenvp;
+    t->sepc = elf.entry;
+    t->sstatus = SSTATUS_SPIE;
+    fpu_reset(t);
+
+    // 任务名取路径的最后一段
+    const char *name = path;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/') {
+            name = p + 1;
+        }
+    }
+    int i;
+    for (i = 0; i < TASK_NAME_LEN - 1 && name[i]; i++) {
+        t->name[i] = name[i];
+    }
+    t->name[i] = '\0';
+
+    console_printf_PROC("exec %s: 入口=0x%lx, argc=%d, 累计映射页=%lu, 复制页=%lu\n",
+                        path, elf.entry, argc, pages_mapped, pages_copied);
+    return argc;
+
+bad:
+    console_printf_PROC("exec: %s 不是有效的ELF程序\n", path);
+    if (pt) {
+        uvmfree(pt);
+    }
+    return -1;
+}
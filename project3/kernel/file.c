@@ -0,0 +1,177 @@
+// file.c - 打开文件表和文件描述符
+//
+// 目前只有两类文件：控制台，以及initramfs中的只读文件。
+
+#include "../include/types.h"
+#include "../include/proc.h"
+#include "../include/file.h"
+#include "../include/initrd.h"
+#include "../include/util.h"
+#include "../include/spinlock.h"
+#include "../include/console.h"
+#include "../include/uaccess.h"
+
+static struct file ftable[NFILE];
+
+// 保护ftable的分配、引用计数和读写偏移
+static struct spinlock ftable_lock = SPINLOCK_INIT("ftable");
+
+static struct file *filealloc(void) {
+    uint64 flags = spin_lock_irqsave(&ftable_lock);
+    for (int i = 0; i < NFILE; i++) {
+        struct file *f = &ftable[i];
+        if (f->ref == 0) {
+            memset(f, 0, sizeof(*f));
+            f->ref = 1;
+            spin_unlock_irqrestore(&ftable_lock, flags);
+            return f;
+        }
+    }
+    spin_unlock_irqrestore(&ftable_lock, flags);
+    console_printf_PROC("打开文件表已满\n");
+    return NULL;
+}
+
+struct file *file_console(void) {
+    struct file *f = filealloc();
+    if (!f) {
+        return NULL;
+    }
+    f->type = FD_CONSOLE;
+    f->readable = 1;
+    f->writable = 1;
+    return f;
+}
+
+struct file *file_open(const char *path, int flags) {
+    const uint8 *data;
+    uint64 size;
+
+    if (flags != O_RDONLY || initrd_lookup(path, &data, &size) < 0) {
+        return NULL;
+    }
+    struct file *f = filealloc();
+    if (!f) {
+        return NULL;
+    }
+    f->type = FD_INITRD;
+    f->readable = 1;
+    f->data = data;
+    f->size = size;
+    return f;
+}
+
+struct file *filedup(struct file *f) {
+    uint64 flags = spin_lock_irqsave(&ftable_lock);
+    if (f->ref < 1) {
+        panic("filedup: 文件未打开");
+    }
+    f->ref++;
+    spin_unlock_irqrestore(&ftable_lock, flags);
+    return f;
+}
+
+void fileclose(struct file *f) {
+    uint64 flags = spin_lock_irqsave(&ftable_lock);
+    if (f->ref < 1) {
+        panic("fileclose: 文件未打开");
+    }
+    if (--f->ref == 0) {
+        f->type = FD_NONE;
+    }
+    spin_unlock_irqrestore(&ftable_lock, flags);
+}
+
+int fileread(struct file *f, void *buf, uint64 n, int nonblock) {
+    if (!f->readable) {
+        return -1;
+    }
+    switch (f->type) {
+        case FD_CONSOLE:
+            return console_read_user((uint64)buf, n, nonblock);
+        case FD_INITRD: {
+            // 共享同一file的任务可能在不同hart上同时读，偏移需要原子地前进
+            uint64 flags = spin_lock_irqsave(&ftable_lock);
+            uint64 off = f->off;
+            if (n > f->size - off) {
+                n = f->size - off;
+            }
+            f->off += n;
+            spin_unlock_irqrestore(&ftable_lock, flags);
+
+            if (copy_to_user((uint64)buf, f->data + off, n) < 0) {
+                return -1;
+            }
+            return n;
+        }
+        default:
+            return -1;
+    }
+}
+
+int filewrite(struct file *f, const void *buf, uint64 n, int nonblock) {
+    if (!f->writable) {
+        return -1;
+    }
+    if (f->type != FD_CONSOLE) {
+        return -1;
+    }
+    return console_write_user((uint64)buf, n, nonblock);
+}
+
+int fd_install(struct task *t, struct file *f) {
+    for (int fd = 0; fd < NOFILE; fd++) {
+        if (!t->ofile[fd]) {
+            t->ofile[fd] = f;
+            return fd;
+        }
+    }
+    return -1;
+}
+
+struct file *fd_get(int fd) {
+    if (fd < 0 || fd >= NOFILE) {
+        return NULL;
+    }
+    return current_task()->ofile[fd];
+}
+
+int fd_dup2(struct task *t, int oldfd, int newfd) {
+    if (oldfd < 0 || oldfd >= NOFILE || newfd < 0 || newfd >= NOFILE || !t->ofile[oldfd]) {
+        return -1;
+    }
+    if (oldfd == newfd) {
+        return newfd;
+    }
+    if (t->ofile[newfd]) {
+        fileclose(t->ofile[newfd]);
+    }
+    t->ofile[newfd] = filedup(t->ofile[oldfd]);
+    return newfd;
+}
+
+int fd_close(struct task *t, int fd) {
+    if (fd < 0 || fd >= NOFILE || !t->ofile[fd]) {
+        return -1;
+    }
+    fileclose(t->ofile[fd]);
+    t->ofile[fd] = NULL;
+    return 0;
+}
+
+void fd_copy(struct task *dst, struct task *src) {
+    for (int fd = 0; fd < NOFILE; fd++) {
+        if (src->ofile[fd]) {
+            dst->ofile[fd] = filedup(src->ofile[fd]);
+        }
+    }
+}
+
+void fd_close_all(struct task *t) {
+    for (int fd = 0; fd < NOFILE; fd++) {
+        if (t->ofile[fd]) {
+            fileclose(t->ofile[fd]);
+            t->ofile[fd] = NULL;
+        }
+    }
+}
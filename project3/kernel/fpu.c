@@ -0,0 +1,164 @@
+// fpu.c - 浮点上下文的延迟保存和恢复
+//
+// 每个hart记录浮点寄存器当前属于哪个任务（fpu_owner），任务记录自己的
+// 浮点寄存器最后加载到了哪个hart（fpu_cpu）。两者一致说明寄存器中仍是
+// 该任务的内容，切换回来时不需要重新加载。任务迁移到其他hart后
+// fpu_cpu改变，回到原hart时就必须从保存的副本加载。
+//
+// 内核其余部分按不含F/D的指令集编译（见Makefile），只有本文件使用浮点指令，
+// 并且只在fpu_save/fpu_restore中、调用者设置FS之后使用。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/fpu.h"
+#include "../include/util.h"
+
+static struct task *fpu_owner[NCPU];
+
+// 保存和加载需要浮点单元处于开启状态，调用者负责设置FS
+static void fpu_save(struct fpu_state *fp) {
+    asm volatile(
+        "fsd f0, 0(%0)\n"
+        "fsd f1, 8(%0)\n"
+        "fsd f2, 16(%0)\n"
+        "fsd f3, 24(%0)\n"
+        "fsd f4, 32(%0)\n"
+        "fsd f5, 40(%0)\n"
+        "fsd f6, 48(%0)\n"
+        "fsd f7, 56(%0)\n"
+        "fsd f8, 64(%0)\n"
+        "fsd f9, 72(%0)\n"
+        "fsd f10, 80(%0)\n"
+        "fsd f11, 88(%0)\n"
+        "fsd f12, 96(%0)\n"
+        "fsd f13, 104(%0)\n"
+        "fsd f14, 112(%0)\n"
+        "fsd f15, 120(%0)\n"
+        "fsd f16, 128(%0)\n"
+        "fsd f17, 136(%0)\n"
+        "fsd f18, 144(%0)\n"
+        "fsd f19, 152(%0)\n"
+        "fsd f20, 160(%0)\n"
+        "fsd f21, 168(%0)\n"
+        "fsd f22, 176(%0)\n"
+        "fsd f23, 184(%0)\n"
+        "fsd f24, 192(%0)\n"
+        "fsd f25, 200(%0)\n"
+        "fsd f26, 208(%0)\n"
+        "fsd f27, 216(%0)\n"
+        "fsd f28, 224(%0)\n"
+        "fsd f29, 232(%0)\n"
+        "fsd f30, 240(%0)\n"
+        "fsd f31, 248(%0)\n"
+        "frcsr t0\n"
+        "sd t0, 256(%0)\n"
+        :: "r"(fp) : "t0", "memory");
+}
+
+static void fpu_restore(struct fpu_state *fp) {
+    asm volatile(
+        "fld f0, 0(%0)\n"
+        "fld f1, 8(%0)\n"
+        "fld f2, 16(%0)\n"
+        "fld f3, 24(%0)\n"
+        "fld f4, 32(%0)\n"
+        "fld f5, 40(%0)\n"
+        "fld f6, 48(%0)\n"
+        "fld f7, 56(%0)\n"
+        "fld f8, 64(%0)\n"
+        "fld f9, 72(%0)\n"
+        "fld f10, 80(%0)\n"
+        "fld f11, 88(%0)\n"
+        "fld f12, 96(%0)\n"
+        "fld f13, 104(%0)\n"
+        "fld f14, 112(%0)\n"
+        "fld f15, 120(%0)\n"
+        "fld f16, 128(%0)\n"
+        "fld f17, 136(%0)\n"
+        "fld f18, 144(%0)\n"
+        "fld f19, 152(%0)\n"
+        "fld f20, 160(%0)\n"
+        "fld f21, 168(%0)\n"
+        "fld f22, 176(%0)\n"
+        "fld f23, 184(%0)\n"
+        "fld f24, 192(%0)\n"
+        "fld f25, 200(%0)\n"
+        "fld f26, 208(%0)\n"
+        "fld f27, 216(%0)\n"
+        "fld f28, 224(%0)\n"
+        "fld f29, 232(%0)\n"
+        "fld f30, 240(%0)\n"
+        "fld f31, 248(%0)\n"
+        "ld t0, 256(%0)\n"
+        "fscsr t0\n"
+        :: "r"(fp) : "t0", "memory");
+}
+
+static void set_fs(uint64 fs) {
+    w_sstatus((r_sstatus() & ~SSTATUS_FS) | fs);
+}
+
+void fpu_init_hart() {
+    w_sstatus(r_sstatus() & ~(SSTATUS_FS | SSTATUS_VS));
+    fpu_owner[cpuid()] = NULL;
+}
+
+void fpu_switch(struct task *prev, struct task *next) {
+    int cpu = cpuid();
+
+    if (prev && prev->state != TASK_ZOMBIE) {
+        // Dirty：寄存器比保存的副本新，保存后寄存器和副本都有效
+        if ((r_sstatus() & SSTATUS_FS) == SSTATUS_FS_DIRTY) {
+            fpu_save(&prev->fpu);
+            prev->fpu_saves++;
+        }
+    } else if (prev && fpu_owner[cpu] == prev) {
+        fpu_owner[cpu] = NULL;
+    }
+
+    if (fpu_owner[cpu] == next && next->fpu_cpu == cpu) {
+        set_fs(SSTATUS_FS_CLEAN);
+    } else {
+        set_fs(SSTATUS_FS_OFF);
+    }
+}
+
+int fpu_trap() {
+    struct task *t = current_task();
+    int cpu = cpuid();
+
+    if ((r_sstatus() & SSTATUS_FS) != SSTATUS_FS_OFF || !t->mm) {
+        return 0;
+    }
+
+    // 本hart上一个使用浮点的任务在切换出去时已经保存（Dirty时），这里直接覆盖
+    set_fs(SSTATUS_FS_CLEAN);
+    fpu_restore(&t->fpu);
+    fpu_owner[cpu] = t;
+    t->fpu_cpu = cpu;
+    t->fpu_restores++;
+    return 1;
+}
+
+void fpu_fork(struct task *c, struct task *p) {
+    uint64 fs = r_sstatus() & SSTATUS_FS;
+
+    // FS不为Off时父进程的寄存器就在本hart上，可能比保存的副本新
+    if (fs != SSTATUS_FS_OFF) {
+        fpu_save(&c->fpu);
+    } else {
+        memcpy(&c->fpu, &p->fpu, sizeof(c->fpu));
+    }
+}
+
+void fpu_reset(struct task *t) {
+    memset(&t->fpu, 0, sizeof(t->fpu));
+    t->fpu_cpu = -1;
+    if (t == current_task()) {
+        if (fpu_owner[cpuid()] == t) {
+            fpu_owner[cpuid()] = NULL;
+        }
+        set_fs(SSTATUS_FS_OFF);
+    }
+}
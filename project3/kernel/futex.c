@@ -0,0 +1,131 @@
+// futex.c - 用户地址上的等待/唤醒
+//
+// 等待队列以用户地址对应的物理地址为键，共享同一物理页的线程（同一个
+// 地址空间中的线程）在同一个键上等待。键散列到固定数量的桶，每个桶有
+// 自己的锁和等待任务链表，不同地址上的等待/唤醒互不竞争。
+//
+// 锁顺序：桶锁 -> sched_lock
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/futex.h"
+#include "../include/vm.h"
+#include "../include/console.h"
+
+#define FUTEX_HASH_SIZE 64
+
+struct futex_bucket {
+    struct spinlock lock;
+    struct task *head;      // 通过task->futex_next链接的等待任务
+};
+
+static struct futex_bucket futex_queues[FUTEX_HASH_SIZE];
+
+void futex_init() {
+    for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
+        spin_init(&futex_queues[i].lock, "futex");
+        futex_queues[i].head = NULL;
+    }
+}
+
+// 用户地址对应的物理地址，作为等待队列的键；无效地址返回0
+static uint64 futex_key(struct task *t, uint64 uaddr) {
+    if (!t->mm || uaddr % sizeof(uint32) != 0) {
+        return 0;
+    }
+    return walkaddr(t->mm->pagetable, uaddr);
+}
+
+static struct futex_bucket *futex_hash(uint64 key) {
+    return &futex_queues[((key >> 2) ^ (key >> 12)) % FUTEX_HASH_SIZE];
+}
+
+int futex_wait(uint64 uaddr, uint32 val) {
+    struct task *t = current_task();
+    uint64 key = futex_key(t, uaddr);
+
+    if (key == 0) {
+        return -1;
+    }
+    struct futex_bucket *b = futex_hash(key);
+    uint64 flags = spin_lock_irqsave(&b->lock);
+
+    // 持有桶锁时检查值：唤醒方修改值之后再获取桶锁，不会丢失唤醒
+    // RAM在内核页表中恒等映射，直接通过物理地址读取
+    if (*(volatile uint32 *)key != val) {
+        spin_unlock_irqrestore(&b->lock, flags);
+        return -1;
+    }
+    t->futex_key = key;
+    t->futex_next = b->head;
+    b->head = t;
+
+    // 与sched_sleep相同：返回用户态前被切换出去，唤醒后系统调用返回0
+    uint64 sflags = spin_lock_irqsave(&sched_lock);
+    t->wakeup_time = ~0ULL;
+    t->state = TASK_SLEEPING;
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, sflags);
+    spin_unlock_irqrestore(&b->lock, flags);
+    return 0;
+}
+
+int futex_wake(uint64 uaddr, int n) {
+    struct task *t = current_task();
+    uint64 key = futex_key(t, uaddr);
+    int woken = 0;
+
+    if (key == 0) {
+        return -1;
+    }
+    struct futex_bucket *b = futex_hash(key);
+    uint64 flags = spin_lock_irqsave(&b->lock);
+    struct task **pp = &b->head;
+
+    while (*pp && woken < n) {
+        struct task *w = *pp;
+        if (w->futex_key != key) {
+            pp = &w->futex_next;
+            continue;
+        }
+        *pp = w->futex_next;
+        w->futex_key = 0;
+        w->futex_next = NULL;
+
+        // 等待者可能已被exit唤醒，只唤醒仍在睡眠的任务
+        uint64 sflags = spin_lock_irqsave(&sched_lock);
+        if (w->state == TASK_SLEEPING) {
+            sched_wakeup_locked(w);
+        }
+        spin_unlock_irqrestore(&sched_lock, sflags);
+        woken++;
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+
+    if (woken) {
+        console_printf_PROC("futex: pid %d 唤醒 %d 个等待者 (0x%lx)\n", t->pid, woken, uaddr);
+    }
+    return woken;
+}
+
+void futex_cancel(struct task *t) {
+    uint64 key = t->futex_key;
+
+    if (key == 0) {
+        return;
+    }
+    struct futex_bucket *b = futex_hash(key);
+    uint64 flags = spin_lock_irqsave(&b->lock);
+
+    for (struct task **pp = &b->head; *pp; pp = &(*pp)->futex_next) {
+        if (*pp == t) {
+            *pp = t->futex_next;
+            break;
+        }
+    }
+    t->futex_key = 0;
+    t->futex_next = NULL;
+    spin_unlock_irqrestore(&b->lock, flags);
+}
@@ -0,0 +1,115 @@
+// initrd.c - 内存中的用户程序归档（cpio newc格式）
+//
+// 构建时tools/mkinitramfs把用户程序打包成cpio归档并写入os.bin的
+// INITRD_SECTOR处。QEMU把整个os.bin加载到内存，归档因此常驻在
+// INITRD_BASE，文件数据可以直接被映射，不需要读盘。
+// mkinitramfs会插入名为".pad"的填充项，使每个文件的数据按页对齐。
+
+#include "../include/types.h"
+#include "../include/memlayout.h"
+#include "../include/initrd.h"
+#include "../include/console.h"
+
+#define CPIO_HDR_SIZE 110
+#define CPIO_TRAILER  "TRAILER!!!"
+
+// 解析8位十六进制字段
+static uint64 cpio_hex(const char *s) {
+    uint64 v = 0;
+    for (int i = 0; i < 8; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+    }
+    return v;
+}
+
+static int streq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+#define ALIGN4(x) (((x) + 3) & ~3ULL)
+
+// 遍历归档，对每个文件调用fn，fn返回非0时停止
+static int cpio_foreach(int (*fn)(const char *name, const uint8 *data, uint64 size, void *arg),
+                        void *arg) {
+    uint64 off = 0;
+
+    while (off + CPIO_HDR_SIZE <= INITRD_MAX) {
+        const char *hdr = (const char *)(INITRD_BASE + off);
+
+        // newc格式的魔数"070701"
+        if (hdr[0] != '0' || hdr[1] != '7' || hdr[2] != '0' ||
+            hdr[3] != '7' || hdr[4] != '0' || hdr[5] != '1') {
+            console_printf_MAIN("initramfs: 偏移0x%lx处魔数错误\n", off);
+            return -1;
+        }
+
+        uint64 filesize = cpio_hex(hdr + 54);
+        uint64 namesize = cpio_hex(hdr + 94);
+        const char *name = hdr + CPIO_HDR_SIZE;
+        const uint8 *data = (const uint8 *)(INITRD_BASE + ALIGN4(off + CPIO_HDR_SIZE + namesize));
+
+        if (streq(name, CPIO_TRAILER)) {
+            return 0;
+        }
+        if (!streq(name, ".pad") && fn(name, data, filesize, arg)) {
+            return 1;
+        }
+        off = ALIGN4((uint64)data - INITRD_BASE + filesize);
+    }
+    return -1;
+}
+
+static int print_entry(const char *name, const uint8 *data, uint64 size, void *arg) {
+    (*(int *)arg)++;
+    console_printf_MAIN("initramfs: %s (%lu 字节, 0x%lx)\n", name, size, (uint64)data);
+    return 0;
+}
+
+void initrd_init() {
+    int count = 0;
+    if (cpio_foreach(print_entry, &count) < 0) {
+        console_printf("initramfs格式错误\n");
+        return;
+    }
+    console_printf_MAIN("initramfs: 共 %d 个文件\n", count);
+}
+
+struct lookup_arg {
+    const char *path;
+    const uint8 *data;
+    uint64 size;
+};
+
+static int match_entry(const char *name, const uint8 *data, uint64 size, void *arg) {
+    struct lookup_arg *la = arg;
+    if (!streq(name, la->path)) {
+        return 0;
+    }
+    la->data = data;
+    la->size = size;
+    return 1;
+}
+
+int initrd_lookup(const char *path, const uint8 **data, uint64 *size) {
+    struct lookup_arg la;
+
+    // 归档中的文件名不带前导'/'
+    while (*path == '/') {
+        path++;
+    }
+    la.path = path;
+    if (cpio_foreach(match_entry, &la) != 1) {
+        return -1;
+    }
+    *data = la.data;
+    *size = la.size;
+    return 0;
+}
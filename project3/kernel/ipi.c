@@ -0,0 +1,102 @@
+// ipi.c - 核间中断
+//
+// 每个hart有一个消息队列，其他hart加入消息后写目标hart的MSIP。
+// 机器软件中断进入entry.S中的machine_vector，转发为SSIP，
+// 目标hart先清除SSIP再取消息，清除之后加入的消息会再次触发中断，不会丢失。
+//
+// 锁顺序：sched_lock -> ipi队列锁（调度器在持有sched_lock时发送重新调度请求）
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/ipi.h"
+#include "../include/memlayout.h"
+#include "../include/console.h"
+
+struct ipi_msg {
+    void (*fn)(void *);
+    void *arg;
+};
+
+struct ipi_queue {
+    struct spinlock lock;
+    struct ipi_msg msgs[NIPIMSG];
+    uint32 head;            // 下一个写入位置
+    uint32 tail;            // 下一个读取位置
+    int resched;            // 有待处理的重新调度请求
+    uint64 nr_recv;         // 收到的核间中断次数
+};
+
+static struct ipi_queue ipi_queues[NCPU];
+
+void ipi_init() {
+    spin_init(&ipi_queues[cpuid()].lock, "ipi");
+}
+
+// 触发目标hart的机器软件中断
+static void ipi_raise(int cpu) {
+    __sync_synchronize();
+    *(volatile uint32 *)CLINT_MSIP(cpu) = 1;
+}
+
+void ipi_resched(int cpu) {
+    struct ipi_queue *q = &ipi_queues[cpu];
+    uint64 flags = spin_lock_irqsave(&q->lock);
+    int pending = q->resched;
+
+    q->resched = 1;
+    spin_unlock_irqrestore(&q->lock, flags);
+    if (!pending) {
+        ipi_raise(cpu);
+    }
+}
+
+int ipi_call(int cpu, void (*fn)(void *), void *arg) {
+    struct ipi_queue *q = &ipi_queues[cpu];
+    uint64 flags = spin_lock_irqsave(&q->lock);
+
+    if (q->head - q->tail >= NIPIMSG) {
+        spin_unlock_irqrestore(&q->lock, flags);
+        return -1;
+    }
+    q->msgs[q->head % NIPIMSG].fn = fn;
+    q->msgs[q->head % NIPIMSG].arg = arg;
+    q->head++;
+    spin_unlock_irqrestore(&q->lock, flags);
+    ipi_raise(cpu);
+    return 0;
+}
+
+void ipi_handler() {
+    struct ipi_queue *q = &ipi_queues[cpuid()];
+
+    w_sip(r_sip() & ~SIP_SSIP);
+    q->nr_recv++;
+
+    uint64 flags = spin_lock_irqsave(&q->lock);
+    if (q->resched) {
+        q->resched = 0;
+        mycpu()->need_resched = 1;
+    }
+    spin_unlock_irqrestore(&q->lock, flags);
+
+    // 逐条取出后在锁外执行，fn可以再次发送核间中断
+    while (1) {
+        struct ipi_msg m;
+
+        flags = spin_lock_irqsave(&q->lock);
+        if (q->tail == q->head) {
+            spin_unlock_irqrestore(&q->lock, flags);
+            break;
+        }
+        m = q->msgs[q->tail % NIPIMSG];
+        q->tail++;
+        spin_unlock_irqrestore(&q->lock, flags);
+
+        m.fn(m.arg);
+    }
+}
+
+uint64 ipi_count(int cpu) {
+    return ipi_queues[cpu].nr_recv;
+}
@@ -0,0 +1,86 @@
+// irqstat.c - 中断进入和退出延迟的直方图
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/timer.h"
+#include "../include/irqstat.h"
+#include "../include/console.h"
+
+static struct irq_stat irq_stats[NCPU][NIRQ_SRC];
+
+static const char *irq_source_names[NIRQ_SRC] = {
+    [IRQ_SRC_TIMER] = "时钟",
+    [IRQ_SRC_EXTERNAL] = "外部",
+};
+
+// 直方图桶号：floor(log2(ticks))
+static int irq_bucket(uint64 ticks) {
+    int b = 0;
+    while (ticks > 1 && b < IRQ_HIST_BUCKETS - 1) {
+        ticks >>= 1;
+        b++;
+    }
+    return b;
+}
+
+// 时钟偏差等原因读到的时间早于触发时刻时按0计
+static uint64 irq_delay(uint64 asserted) {
+    uint64 now = r_time();
+    return now > asserted ? now - asserted : 0;
+}
+
+void irq_latency_entry(enum irq_source src, uint64 asserted) {
+    struct irq_stat *st = &irq_stats[cpuid()][src];
+    uint64 delay = irq_delay(asserted);
+
+    st->count++;
+    st->entry_sum += delay;
+    if (delay > st->entry_max) {
+        st->entry_max = delay;
+    }
+    st->entry_hist[irq_bucket(delay)]++;
+}
+
+void irq_latency_exit(enum irq_source src, uint64 asserted) {
+    struct irq_stat *st = &irq_stats[cpuid()][src];
+    uint64 delay = irq_delay(asserted);
+
+    st->exit_sum += delay;
+    if (delay > st->exit_max) {
+        st->exit_max = delay;
+    }
+    st->exit_hist[irq_bucket(delay)]++;
+}
+
+// 其他hart可能同时在更新，取到的是近似的快照
+int irq_stat_get(int hart, int src, struct irq_stat *st) {
+    if (hart < 0 || hart >= NCPU || src < 0 || src >= NIRQ_SRC) {
+        return -1;
+    }
+    *st = irq_stats[hart][src];
+    return 0;
+}
+
+// tick换算为纳秒
+#define TICKS_TO_NS(t)  ((t) * 1000 / (CLOCK_FREQ / 1000000))
+
+void irq_stat_print() {
+    for (int h = 0; h < NCPU; h++) {
+        if (!((cpu_online_mask >> h) & 1)) {
+            continue;
+        }
+        for (int s = 0; s < NIRQ_SRC; s++) {
+            struct irq_stat st;
+            irq_stat_get(h, s, &st);
+            if (st.count == 0) {
+                continue;
+            }
+            console_printf("hart %d: %s中断 %lu 次, 进入延迟 平均 %lu ns/最大 %lu ns, "
+                           "退出延迟 平均 %lu ns/最大 %lu ns\n", h, irq_source_names[s], st.count,
+                           TICKS_TO_NS(st.entry_sum / st.count), TICKS_TO_NS(st.entry_max),
+                           TICKS_TO_NS(st.exit_sum / st.count), TICKS_TO_NS(st.exit_max));
+        }
+    }
+}
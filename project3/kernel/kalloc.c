@@ -0,0 +1,157 @@
+// kalloc.c - 物理页分配器
+//
+// 空闲页分两条链表：未清零的页和已清零的页。kfree把页放入未清零链表，
+// 清零工作交给kworker在开中断时完成，kalloc_zeroed因此通常不需要
+// 在调用者的上下文中清零整页。
+
+#include "../include/types.h"
+#include "../include/memlayout.h"
+#include "../include/kalloc.h"
+#include "../include/workqueue.h"
+#include "../include/spinlock.h"
+#include "../include/util.h"
+#include "../include/console.h"
+
+// 链接脚本中定义的内核结束地址
+extern char kernel_end[];
+
+// 预先清零的页数目标
+#define ZERO_POOL_TARGET 64
+
+// 每次工作项最多清零的页数，避免长时间占用kworker
+#define ZERO_BATCH       16
+
+struct run {
+    struct run *next;
+};
+
+static struct run *dirty_list;      // 未清零的空闲页
+static struct run *zeroed_list;     // 已清零的空闲页
+static uint64 nr_dirty;
+static uint64 nr_zeroed;
+
+// 保护两条空闲链表和计数
+static struct spinlock kmem_lock = SPINLOCK_INIT("kmem");
+
+static struct work zero_work;
+
+static void zero_pages_work(struct work *w);
+
+// 把一段物理内存加入空闲链表
+static void freerange(uint64 start, uint64 end) {
+    for (uint64 pa = PGROUNDUP(start); pa + PGSIZE <= end; pa += PGSIZE) {
+        struct run *r = (struct run *)pa;
+        r->next = dirty_list;
+        dirty_list = r;
+        nr_dirty++;
+    }
+}
+
+// 初始化物理页分配器，跳过内核镜像和initramfs
+void kinit() {
+    INIT_WORK(&zero_work, zero_pages_work);
+    freerange((uint64)kernel_end, INITRD_BASE);
+    freerange(INITRD_BASE + INITRD_MAX, PHYSTOP);
+    console_printf_PAGE("物理页分配器初始化完成，空闲页: %lu\n", nr_dirty);
+}
+
+// 需要时请求kworker补充已清零的页
+static void zero_pool_refill(void) {
+    if (nr_zeroed < ZERO_POOL_TARGET && nr_dirty > 0) {
+        queue_work(&zero_work);
+    }
+}
+
+// 下半部：在开中断状态下清零空闲页
+static void zero_pages_work(struct work *w) {
+    for (int i = 0; i < ZERO_BATCH; i++) {
+        uint64 flags = spin_lock_irqsave(&kmem_lock);
+        struct run *r = NULL;
+        if (nr_zeroed < ZERO_POOL_TARGET && dirty_list) {
+            r = dirty_list;
+            dirty_list = r->next;
+            nr_dirty--;
+        }
+        spin_unlock_irqrestore(&kmem_lock, flags);
+
+        if (!r) {
+            return;
+        }
+        memset(r, 0, PGSIZE);
+
+        flags = spin_lock_irqsave(&kmem_lock);
+        r->next = zeroed_list;
+        zeroed_list = r;
+        nr_zeroed++;
+        spin_unlock_irqrestore(&kmem_lock, flags);
+    }
+    zero_pool_refill();
+}
+
+// 从链表中取出一页
+static struct run *pop(struct run **list, uint64 *count) {
+    struct run *r = *list;
+    if (r) {
+        *list = r->next;
+        (*count)--;
+    }
+    return r;
+}
+
+void *kalloc() {
+    uint64 flags = spin_lock_irqsave(&kmem_lock);
+    // 不需要清零时优先使用未清零的页，把已清零的页留给kalloc_zeroed
+    struct run *r = pop(&dirty_list, &nr_dirty);
+    if (!r) {
+        r = pop(&zeroed_list, &nr_zeroed);
+    }
+    spin_unlock_irqrestore(&kmem_lock, flags);
+
+    if (!r) {
+        console_printf_PAGE("物理内存耗尽\n");
+    }
+    return r;
+}
+
+void *kalloc_zeroed() {
+    uint64 flags = spin_lock_irqsave(&kmem_lock);
+    struct run *r = pop(&zeroed_list, &nr_zeroed);
+    int need_zero = 0;
+    if (!r) {
+        r = pop(&dirty_list, &nr_dirty);
+        need_zero = 1;
+    }
+    zero_pool_refill();
+    spin_unlock_irqrestore(&kmem_lock, flags);
+
+    if (!r) {
+        console_printf_PAGE("物理内存耗尽\n");
+        return NULL;
+    }
+    if (need_zero) {
+        memset(r, 0, PGSIZE);
+    } else {
+        // 清零后链表指针写入了页的第一个字
+        r->next = NULL;
+    }
+    return r;
+}
+
+void kfree(void *pa) {
+    struct run *r = (struct run *)pa;
+
+    if ((uint64)pa % PGSIZE != 0 || (uint64)pa < (uint64)kernel_end || (uint64)pa >= PHYSTOP) {
+        panic("kfree: 非法物理地址");
+    }
+
+    uint64 flags = spin_lock_irqsave(&kmem_lock);
+    r->next = dirty_list;
+    dirty_list = r;
+    nr_dirty++;
+    zero_pool_refill();
+    spin_unlock_irqrestore(&kmem_lock, flags);
+}
+
+uint64 kfree_pages() {
+    return nr_dirty + nr_zeroed;
+}
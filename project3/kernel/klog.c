@@ -0,0 +1,293 @@
+// klog.c - 每个hart的无锁日志缓冲区
+//
+// 每个缓冲区只有一个生产者：所属hart。写入期间关本地中断，避免同一hart上的
+// 中断处理函数重入；head只由生产者写，tail只由输出方写，两边都不需要锁。
+// 输出方（hart 0的时钟中断触发的SOFTIRQ_LOG软中断，或挂起前的klog_flush）之间用klog_lock互斥，
+// 按时间戳合并各hart的日志，格式化后写入控制台。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/trap.h"
+#include "../include/spinlock.h"
+#include "../include/workqueue.h"
+#include "../include/console.h"
+#include "../include/klog.h"
+#include "../include/timer.h"
+
+#define KLOG_NREC    128    // 每个hart的日志记录数，2的幂
+#define KLOG_MAXARGS 6      // 每条日志最多保存的参数个数
+#define KLOG_STRBUF  40     // 每条日志中%s参数复制的字符串总长度
+
+// 日志记录：格式化推迟到输出时进行
+// %s参数指向的字符串可能在输出前被释放或改写（栈上的路径、退出任务的名字），
+// 写入时复制到str中，对应的参数保存为在str中的偏移
+struct klog_record {
+    uint64 time;
+    const char *prefix;
+    const char *fmt;
+    uint32 nargs;
+    uint32 strmask;         // 第i位为1表示args[i]是str中的偏移
+    uint32 suppressed;      // 同一调用点上一秒被限速抑制的日志数
+    uint64 args[KLOG_MAXARGS];
+    char str[KLOG_STRBUF];
+};
+
+struct klog_ring {
+    struct klog_record recs[KLOG_NREC];
+    volatile uint64 head;       // 下一个写入位置，只由所属hart写
+    volatile uint64 tail;       // 下一个输出位置，只由输出方写
+    volatile uint64 dropped;    // 缓冲区满时丢弃的日志数，只由所属hart写
+    uint64 reported;            // 已经报告过的丢弃数，只由输出方访问
+} __attribute__((aligned(64)));
+
+static struct klog_ring klog_rings[NCPU];
+static struct spinlock klog_lock = SPINLOCK_INIT("klog");
+
+// 二进制跟踪的格式串所在的段（kernel.ld），格式ID是格式串相对段首的偏移
+extern const char __klog_fmt_start[];
+
+// 按console_vprintf支持的格式解析参数：%[0][宽度][l]转换字符
+// 返回参数个数，*strmask中标出%s参数
+static int klog_parse(const char *fmt, uint32 *strmask) {
+    int n = 0;
+
+    *strmask = 0;
+    while (*fmt && n < KLOG_MAXARGS) {
+        if (*fmt++ != '%') {
+            continue;
+        }
+        while (*fmt >= '0' && *fmt <= '9') {
+            fmt++;
+        }
+        if (*fmt == 'l') {
+            fmt++;
+        }
+        switch (*fmt) {
+            case 's':
+                *strmask |= 1U << n;
+                n++;
+                break;
+            case 'c':
+            case 'd':
+            case 'u':
+            case 'x':
+            case 'p':
+                n++;
+                break;
+            case '\0':
+                return n;
+            default:
+                break;
+        }
+        fmt++;
+    }
+    return n;
+}
+
+// 调用点限速，允许输出时返回1，*suppressed为上一个窗口被抑制的条数
+// 窗口切换时多个hart的竞争只会让个别日志多输出或少计数，不需要锁
+static int klog_ratelimit(struct klog_ratelimit *rl, uint32 *suppressed) {
+    uint64 now = r_time();
+    uint64 begin = rl->begin;
+
+    *suppressed = 0;
+    if (now - begin >= CLOCK_FREQ && __sync_bool_compare_and_swap(&rl->begin, begin, now)) {
+        rl->count = 0;
+        *suppressed = __atomic_exchange_n(&rl->suppressed, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_fetch_add(&rl->count, 1, __ATOMIC_RELAXED) >= KLOG_RATELIMIT_BURST) {
+        __atomic_fetch_add(&rl->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+// 写入一条记录：复制%s参数，其他参数原样保存
+static void klog_put(const char *prefix, const char *fmt, struct klog_ratelimit *rl,
+                     int nargs, uint32 strmask, va_list args) {
+    uint32 suppressed;
+
+    if (!klog_ratelimit(rl, &suppressed)) {
+        return;
+    }
+
+    uint64 flags = irq_save();
+    struct klog_ring *ring = &klog_rings[cpuid()];
+    uint64 head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= KLOG_NREC) {
+        ring->dropped++;
+        irq_restore(flags);
+        return;
+    }
+
+    struct klog_record *rec = &ring->recs[head % KLOG_NREC];
+    uint32 used = 0;
+
+    if (nargs > KLOG_MAXARGS) {
+        nargs = KLOG_MAXARGS;
+    }
+    rec->time = r_time();
+    rec->prefix = prefix;
+    rec->fmt = fmt;
+    rec->nargs = nargs;
+    rec->strmask = strmask;
+    rec->suppressed = suppressed;
+    for (int i = 0; i < nargs; i++) {
+        if (!(strmask & (1U << i))) {
+            // RISC-V LP64下整数和指针参数都以64位寄存器传递
+            rec->args[i] = va_arg(args, uint64);
+            continue;
+        }
+        // 放不下的部分截断，缓冲区用完后的字符串输出为空串
+        const char *s = va_arg(args, const char *);
+        if (!s) {
+            s = "(null)";
+        }
+        rec->args[i] = used;
+        while (*s && used < KLOG_STRBUF - 1) {
+            rec->str[used++] = *s++;
+        }
+        if (used < KLOG_STRBUF) {
+            rec->str[used++] = '\0';
+        }
+    }
+    // 记录内容写完之后才发布给输出方
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    irq_restore(flags);
+}
+
+void klog_write(const char *prefix, const char *fmt, struct klog_ratelimit *rl, va_list args) {
+    uint32 strmask;
+    int nargs = klog_parse(fmt, &strmask);
+
+    klog_put(prefix, fmt, rl, nargs, strmask, args);
+}
+
+void klog_write_trace(const char *prefix, const char *fmt, struct klog_ratelimit *rl,
+                      int nargs, uint32 strmask, va_list args) {
+    klog_put(prefix, fmt, rl, nargs, strmask, args);
+}
+
+// 取出时间最早的一条日志，没有日志返回-1
+// 有丢弃时*dropped为该hart上次报告以来丢弃的条数
+static int klog_pop(struct klog_record *out, uint64 *dropped) {
+    uint64 flags = spin_lock_irqsave(&klog_lock);
+    struct klog_ring *oldest = NULL;
+    int hart = -1;
+
+    *dropped = 0;
+    for (int i = 0; i < NCPU; i++) {
+        struct klog_ring *ring = &klog_rings[i];
+        uint64 tail = ring->tail;
+        if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (!oldest || ring->recs[tail % KLOG_NREC].time < oldest->recs[oldest->tail % KLOG_NREC].time) {
+            oldest = ring;
+            hart = i;
+        }
+    }
+    if (oldest) {
+        *out = oldest->recs[oldest->tail % KLOG_NREC];
+        // 复制完成之后才让生产者重用这个位置
+        __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+
+        uint64 total = oldest->dropped;
+        *dropped = total - oldest->reported;
+        oldest->reported = total;
+    }
+    spin_unlock_irqrestore(&klog_lock, flags);
+    return hart;
+}
+
+// 写入一个无符号LEB128整数，返回写入的字节数
+static int klog_put_varint(uint8 *p, uint64 v) {
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+// 输出一个二进制跟踪帧：
+//   0xff 长度 前缀ID(2字节) 格式ID(2字节) 参数...
+// 0xff不会出现在UTF-8文本中，解码器据此把帧从普通的控制台输出中分离出来。
+// 整数参数先做zigzag编码（小的负数也很短）再写成LEB128，字符串参数以'\0'结尾。
+// 帧内的字节不做\n到\r\n的转换
+static void klog_emit_trace(struct klog_record *rec) {
+    uint8 frame[2 + 4 + KLOG_MAXARGS * 10 + KLOG_STRBUF];
+    uint64 prefix_id = rec->prefix - __klog_fmt_start;
+    uint64 fmt_id = rec->fmt - __klog_fmt_start;
+    int n = 2;
+
+    frame[n++] = prefix_id;
+    frame[n++] = prefix_id >> 8;
+    frame[n++] = fmt_id;
+    frame[n++] = fmt_id >> 8;
+    for (uint32 i = 0; i < rec->nargs; i++) {
+        if (rec->strmask & (1U << i)) {
+            const char *s = rec->args[i] < KLOG_STRBUF ? &rec->str[rec->args[i]] : "";
+            do {
+                frame[n++] = *s;
+            } while (*s++);
+        } else {
+            int64 v = rec->args[i];
+            n += klog_put_varint(&frame[n], ((uint64)v << 1) ^ (uint64)(v >> 63));
+        }
+    }
+    frame[0] = 0xff;
+    frame[1] = n - 2;
+    console_write_raw((const char *)frame, n);
+}
+
+// 格式化并输出所有hart的日志
+static void klog_drain(void) {
+    struct klog_record rec;
+    uint64 dropped;
+    int hart;
+
+    while ((hart = klog_pop(&rec, &dropped)) >= 0) {
+        if (dropped) {
+            console_printf("[LOG] hart %d 丢弃了 %lu 条日志\n", hart, dropped);
+        }
+        if (rec.suppressed) {
+            console_printf("[LOG] 下一条日志的调用点在上一秒被限速抑制了 %d 条\n", rec.suppressed);
+        }
+        if (KLOG_BINARY) {
+            klog_emit_trace(&rec);
+            continue;
+        }
+        for (uint32 i = 0; i < rec.nargs; i++) {
+            if (rec.strmask & (1U << i)) {
+                rec.args[i] = rec.args[i] < KLOG_STRBUF ? (uint64)&rec.str[rec.args[i]] : (uint64)"";
+            }
+        }
+        console_printf("%s", rec.prefix);
+        console_printf(rec.fmt, rec.args[0], rec.args[1], rec.args[2],
+                       rec.args[3], rec.args[4], rec.args[5]);
+    }
+}
+
+// 由hart 0的时钟中断检查，检查只读取各hart的head和tail
+void klog_tick() {
+    for (int i = 0; i < NCPU; i++) {
+        struct klog_ring *ring = &klog_rings[i];
+        if (ring->tail != ring->head) {
+            raise_softirq(SOFTIRQ_LOG);
+            return;
+        }
+    }
+}
+
+void klog_flush() {
+    klog_drain();
+}
+
+void klog_init() {
+    open_softirq(SOFTIRQ_LOG, klog_drain);
+}
@@ -0,0 +1,110 @@
+// kthread.c - 内核线程
+//
+// 内核线程是运行在S模式的任务，和用户任务一样由调度器管理。
+// 它们通过S模式的ecall（scause=9）请求yield/sleep/exit，
+// trap_handler把这类ecall当作系统调用处理并在返回前重新调度。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/kthread.h"
+#include "../include/syscall.h"
+#include "../include/trap.h"
+#include "../include/util.h"
+#include "../include/console.h"
+
+// 内核线程栈
+static uint8 kthread_stack[NKTHREAD][KTHREAD_STACK_SIZE] __attribute__((aligned(16)));
+
+// 每个栈当前的使用者
+static struct task *kstack_owner[NKTHREAD];
+static int kstack_owner_pid[NKTHREAD];
+
+// 保护kstack_owner，多个hart可能同时创建内核线程
+static struct spinlock kstack_lock = SPINLOCK_INIT("kstack");
+
+// 从S模式发起系统调用
+static inline uint64 kcall(uint64 num, uint64 arg) {
+    register uint64 a0 asm("a0") = arg;
+    register uint64 a7 asm("a7") = num;
+    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+    return a0;
+}
+
+// 内核线程入口：a0=fn, a1=arg
+static void kthread_entry(void (*fn)(void *), void *arg) {
+    fn(arg);
+    kthread_exit();
+}
+
+// 查找空闲的内核线程栈，栈的上一个使用者退出后即可复用
+static int kstack_alloc(void) {
+    for (int i = 0; i < NKTHREAD; i++) {
+        struct task *owner = kstack_owner[i];
+        if (!owner || owner->state == TASK_UNUSED || owner->pid != kstack_owner_pid[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 创建内核线程
+struct task *kthread_create(const char *name, void (*fn)(void *), void *arg) {
+    return kthread_create_on(name, fn, arg, -1);
+}
+
+struct task *kthread_create_on(const char *name, void (*fn)(void *), void *arg, int cpu) {
+    uint64 flags = spin_lock_irqsave(&kstack_lock);
+    int slot = kstack_alloc();
+    if (slot < 0) {
+        spin_unlock_irqrestore(&kstack_lock, flags);
+        console_printf_PROC("内核线程栈已用完\n");
+        return NULL;
+    }
+
+    struct task *t = task_create_kernel(name, (void (*)(void))kthread_entry,
+                                        (uint64)&kthread_stack[slot][KTHREAD_STACK_SIZE]);
+    if (!t) {
+        spin_unlock_irqrestore(&kstack_lock, flags);
+        return NULL;
+    }
+    t->tf.regs[REG_A0] = (uint64)fn;
+    t->tf.regs[REG_A1] = (uint64)arg;
+    if (cpu >= 0) {
+        t->cpus_allowed = 1ULL << cpu;
+        t->cpu = cpu;
+    }
+
+    kstack_owner[slot] = t;
+    kstack_owner_pid[slot] = t->pid;
+    spin_unlock_irqrestore(&kstack_lock, flags);
+    sched_wakeup(t);
+    return t;
+}
+
+void kthread_yield() {
+    kcall(SYS_yield, 0);
+}
+
+void kthread_sleep(uint64 milliseconds) {
+    kcall(SYS_sleep, milliseconds);
+}
+
+void kthread_exit() {
+    kcall(SYS_exit, 0);
+    panic("已退出的内核线程被重新调度");
+}
+
+// 阻塞当前线程：状态设为睡眠且没有唤醒时间，只能由sched_wakeup唤醒
+// 或由本hart把wakeup_time置0（调度器在schedule中唤醒到期任务）
+void kthread_park() {
+    kthread_park_prepare();
+    kcall(SYS_yield, 0);
+}
+
+void kthread_park_prepare() {
+    struct task *t = current_task();
+    t->wakeup_time = ~0ULL;
+    t->state = TASK_SLEEPING;
+}
@@ -5,32 +5,32 @@
 #include "../include/timer.h"
 #include "../include/syscall.h"
 #include "../include/util.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/workqueue.h"
+#include "../include/kalloc.h"
+#include "../include/vm.h"
+#include "../include/initrd.h"
+#include "../include/memlayout.h"
+#include "../include/futex.h"
+#include "../include/ipi.h"
+#include "../include/vdso.h"
+#include "../include/fpu.h"
+#include "../include/plic.h"
+#include "../include/uart.h"
+#include "../include/klog.h"
 #include "qemu_detect.c"
 
 
-// 用户程序地址和栈地址
-#define USER_PROGRAM_ADDR 0x80400000ULL
-#define USER_STACK_TOP    0x80800000ULL
-
-// 用户程序在磁盘上的位置
-#define USER_SECTOR 64
-#define SECTOR_SIZE 512
-
 extern void trap_vector();
+extern void _entry();
+extern void machine_vector();
+extern uint64 machine_scratch[NCPU][2];
 
-
-
-// 切换到用户模式并执行用户程序
-void switch_to_user_mode() {
-    console_printf_MAIN("准备切换到用户模式...\n");
-    
-    // 打印用户程序前16字节，检查是否正确加载
-    uint8 *program = (uint8*)USER_PROGRAM_ADDR;
-    console_printf_MAIN("用户程序前16字节: ");
-    for(int i = 0; i < 16; i++) {
-        console_printf_MAIN("%02x ", program[i]);
-    }
-    console_printf_MAIN("\n");
+// 开始运行当前hart上的第一个任务（hart 0为init，其他hart为空闲任务）
+static void start_first_task(struct task *t) {
+    console_printf_MAIN("hart %d 启动任务 %s (pid=%d)\n", cpuid(), t->name, t->pid);
+    console_printf_MAIN("入口: 0x%lx, 栈: 0x%lx\n", t->sepc, t->frame[REG_SP]);
     
     // 确保中断处理已初始化
     console_printf_MAIN("当前STVEC: 0x%lx\n", r_stvec());
@@ -41,69 +41,47 @@ void switch_to_user_mode() {
     w_sie(sie);
     console_printf_MAIN("SIE设置后: 0x%lx\n", r_sie());
     
-    // 设置SEPC（异常程序计数器）为用户程序入口点
-    uint64 user_entry = (uint64)USER_PROGRAM_ADDR;
-    w_sepc(user_entry);
+    // 设置SEPC（异常程序计数器）为任务入口点
+    w_sepc(t->sepc);
     
     // 设置SSTATUS
+    // 内核自身不开中断（SIE保持为0），sret之后由SPIE打开中断，
+    // 避免在sret之前被时钟中断调度走
     uint64 sstatus = r_sstatus();
-    sstatus &= ~SSTATUS_SPP;  // 清除SPP位，表示返回到用户模式
-    sstatus |= SSTATUS_SPIE;  // 设置SPIE位，确保返回后中断启用
-    sstatus |= SSTATUS_SIE;   // 直接启用中断
+    sstatus &= ~(SSTATUS_SPP | SSTATUS_SPIE);
+    sstatus |= t->sstatus;      // 用户任务SPP=0，内核任务SPP=1
     w_sstatus(sstatus);
     
+    // 任务成为当前hart上运行的任务，同时切换到它的页表
+    sched_start(t);
+    
     console_printf_MAIN("最终检查 - SEPC: 0x%lx, SSTATUS: 0x%lx, SIE: 0x%lx\n", 
                   r_sepc(), r_sstatus(), r_sie());
     console_printf_MAIN("即将执行sret指令...\n");
     
-    // 使用内联汇编执行sret指令，同时设置sp寄存器
-    asm volatile(
-        "li sp, 0x80800000\n"  // 设置sp为用户栈
-        "sret\n"               // 切换到用户模式
-    );
-    
-    // 如果执行到这里，说明从用户模式返回了
-    console_printf_MAIN("错误：从用户模式返回\n");
-}
-
-// 加载用户程序
-void load_user_program() {
-    console_printf_MAIN("加载用户程序...\n");
-    
-    // 清空用户程序区域
-    char *dst = (char*)USER_PROGRAM_ADDR;
-    for(uint32 i = 0; i < 16 * SECTOR_SIZE; i++) {
-        dst[i] = 0;
+    // 从任务的trap帧经由trap_vector的恢复路径sret
+    if (t->sstatus & SSTATUS_SPP) {
+        t->frame[REG_TP] = cpuid();
+        w_sscratch(0);
+    } else {
+        trap_prepare_user(t);
     }
-    
-    // 从磁盘读取用户程序
-    disk_read((void*)USER_PROGRAM_ADDR, USER_SECTOR * SECTOR_SIZE, 16 * SECTOR_SIZE);
-    
-    // 验证用户程序是否成功加载
-    uint8 *program = (uint8*)USER_PROGRAM_ADDR;
-    if (program[0] == 0 && program[1] == 0 && program[2] == 0 && program[3] == 0) {
-        console_printf_MAIN("警告：用户程序前4字节为零，可能未正确加载\n");
-    }
-    
-    console_printf_MAIN("用户程序已加载到地址 0x%lx\n", (unsigned long)USER_PROGRAM_ADDR);
+    trap_return(t->frame);
 }
 
-// 内核入口函数
-void kernel_main() {
-    // 初始化控制台
-    console_init();
-    console_printf_MAIN("控制台初始化完成\n");
-    // 检测QEMU环境
-    detect_qemu_environment();
+void supervisor_main();
+void supervisor_main_ap();
 
-     // 设置异常委托
+// 每个hart的M模式初始化：委托trap、开放物理内存和计数器
+static void machine_init() {
+    // 设置异常委托
     uint64 medeleg = 0;
     uint64 mideleg = 0;
     
     // 委托所有异常给S模式
     asm volatile("csrw medeleg, %0" : : "r" (0xFFFFULL));
-    // 委托所有中断给S模式
-    asm volatile("csrw mideleg, %0" : : "r" (0xFFULL));
+    // 委托所有中断给S模式，包括PLIC的S模式外部中断（SEIP，第9位）
+    asm volatile("csrw mideleg, %0" : : "r" (0xFFULL | (1ULL << 9)));
     
     // 再次读取确认设置成功
     asm volatile("csrr %0, medeleg" : "=r" (medeleg));
@@ -112,37 +90,140 @@ void kernel_main() {
     asm volatile("csrr %0, mideleg" : "=r" (mideleg));
     console_printf_MAIN("设置后MIDELEG: 0x%lx\n", mideleg);
     
+    // 配置PMP，允许S/U模式访问全部物理地址空间
+    w_pmpaddr0(0x3fffffffffffffULL);
+    w_pmpcfg0(0xf);
+    
+    // 允许S/U模式通过rdtime/rdcycle读取计数器
+    w_mcounteren(r_mcounteren() | MCOUNTEREN_TM | MCOUNTEREN_CY);
+    
+    // 启用Sstc扩展：S模式直接通过stimecmp产生时钟中断，无需M模式转发
+    w_menvcfg(r_menvcfg() | MENVCFG_STCE);
+    
+    // 核间中断：机器软件中断不能委托，由machine_vector转发为S模式软件中断
+    w_mscratch((uint64)machine_scratch[cpuid()]);
+    w_mtvec((uint64)machine_vector);
+    w_mie(r_mie() | MIE_MSIE);
+}
+
+// 从M模式切换到S模式，继续执行entry
+static void enter_supervisor_mode(void (*entry)()) {
+    // mret返回到S模式的entry
+    uint64 mstatus = r_mstatus();
+    mstatus &= ~MSTATUS_MPP_MASK;
+    mstatus |= MSTATUS_MPP_S;
+    w_mstatus(mstatus);
+    w_mepc((uint64)entry);
+    
+    console_printf_MAIN("hart %d 切换到S模式...\n", cpuid());
+    asm volatile("mret");
+}
+
+// 内核入口函数（M模式），每个hart都从_entry进入
+void kernel_main() {
+    // tp保存当前hart ID，S模式下无法读取mhartid
+    w_tp(r_mhartid());
+    
+    if (cpuid() != 0) {
+        // 其他hart：控制台等全局状态已由hart 0初始化
+        machine_init();
+        enter_supervisor_mode(supervisor_main_ap);
+    }
+    
+    // 初始化控制台
+    console_init();
+    console_printf_MAIN("控制台初始化完成\n");
+    // 检测QEMU环境
+    detect_qemu_environment();
+
+    machine_init();
     
     // 测试控制台打印功能
     //console_test();
     
+    // 以下在S模式下运行
+    enter_supervisor_mode(supervisor_main);
+}
+
+// 每个hart的S模式初始化
+static void supervisor_init_hart() {
+    kvminithart();
+    
+    // 允许内核直接访问当前地址空间中的用户页（系统调用参数）
+    w_sstatus(r_sstatus() | SSTATUS_SUM);
+    
+    // 允许用户程序读取time和cycle（计时和微基准测试）
+    w_scounteren(r_scounteren() | MCOUNTEREN_TM | MCOUNTEREN_CY);
+    
+    // 浮点单元先关闭，任务第一次使用浮点时再加载它的寄存器
+    fpu_init_hart();
+    
     // 初始化中断处理
     trap_init();
-    console_printf_MAIN("中断处理初始化完成\n");
+    
+    // 初始化核间中断消息队列
+    ipi_init();
     
     // 初始化时钟
     timer_init();
-    console_printf_MAIN("时钟初始化完成\n");
     
-    // 启用中断
-    w_sstatus(r_sstatus() | SSTATUS_SIE);
-    console_printf_MAIN("中断已启用\n");
+    // 外部中断经PLIC路由到各hart的S模式上下文
+    plic_init_hart();
     
-    // 启用时钟中断
-    w_sie(r_sie() | SIE_STIE);
-    console_printf_MAIN("时钟中断已启用\n");
+    // 启用时钟中断、软件中断（核间中断）和外部中断
+    // 全局中断（SSTATUS_SIE）在进入用户态或空闲任务时通过sret打开
+    w_sie(r_sie() | SIE_STIE | SIE_SSIE | SIE_SEIE);
+    
+    // 初始化调度器（创建本hart的空闲任务）
+    sched_init();
+    
+    // 创建本hart的kworker线程，处理中断下半部（hart 0的kworker还输出日志缓冲区）
+    workqueue_init();
+}
+
+// S模式内核主函数
+void supervisor_main() {
+    // 初始化物理页分配器并启用分页
+    kinit();
+    kvminit();
+    // 时间零点为内核启动时刻，之后的时钟信息和用户态时间都以它为准
+    vdso_init();
+    plic_init();
+    klog_init();
+    supervisor_init_hart();
+    // 此后控制台输出写入发送缓冲区，由串口中断发送
+    uart_intr_enable();
+    console_printf_MAIN("hart 0 初始化完成\n");
     
     console_printf_MAIN("内核初始化完成，准备加载用户程序...\n");
     
-    // 加载用户程序
-    load_user_program();
+    // 初始化futex等待队列
+    futex_init();
     
-    // 切换到用户模式并执行用户程序
-    switch_to_user_mode();
+    // 检查initramfs中的用户程序
+    initrd_init();
     
-    // 如果从switch_to_user_mode返回，进入空闲循环
-    console_printf_MAIN("进入空闲循环\n");
-    while (1) {
-        asm volatile("wfi");
+    // 从initramfs创建第一个用户任务
+    char *init_argv[] = { "init", NULL };
+    struct task *init = task_create_user("/init", init_argv);
+    if (!init) {
+        panic("无法创建init任务");
     }
-}
\ No newline at end of file
+    
+    // 释放其他hart：它们在bootloader中等待入口地址
+    __sync_synchronize();
+    *(volatile uint64 *)BOOT_RELEASE_ADDR = (uint64)_entry;
+    __sync_synchronize();
+    
+    // 切换到用户模式并执行用户程序
+    start_first_task(init);
+}
+
+// 其他hart的S模式入口
+void supervisor_main_ap() {
+    supervisor_init_hart();
+    console_printf_MAIN("hart %d 初始化完成\n", cpuid());
+    
+    // 从空闲任务开始，时钟中断到来后参与调度
+    start_first_task(mycpu()->idle);
+}
@@ -0,0 +1,151 @@
+// plic.c - 平台级中断控制器驱动
+//
+// 驱动用request_irq按中断源编号注册处理函数，并指定优先级和路由到哪些hart。
+// 每个hart的S模式上下文有自己的使能位和优先级阈值；外部中断到达时
+// plic_dispatch在一次trap中连续claim，直到没有待处理的中断源，
+// 多个设备同时发出的中断不需要各自进入一次trap。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/memlayout.h"
+#include "../include/proc.h"
+#include "../include/spinlock.h"
+#include "../include/plic.h"
+
+// hart的S模式上下文编号（0是M模式上下文）
+#define PLIC_SCONTEXT(hart)     (2 * (hart) + 1)
+
+#define PLIC_PRIORITY(irq)      (PLIC_BASE + 4 * (irq))
+#define PLIC_SENABLE(hart, irq) (PLIC_BASE + 0x2000 + PLIC_SCONTEXT(hart) * 0x80 + ((irq) / 32) * 4)
+#define PLIC_STHRESHOLD(hart)   (PLIC_BASE + 0x200000 + PLIC_SCONTEXT(hart) * 0x1000)
+#define PLIC_SCLAIM(hart)       (PLIC_STHRESHOLD(hart) + 4)
+
+struct irq_desc {
+    irq_handler_t handler;
+    void *arg;
+    uint64 hart_mask;       // 使能了该中断源的hart
+    uint64 count;           // 处理次数
+};
+
+static struct irq_desc irq_descs[PLIC_NSOURCES];
+static uint64 spurious;
+
+// 保护注册表和使能寄存器的读-改-写
+static struct spinlock plic_lock = SPINLOCK_INIT("plic");
+
+static inline void plic_write(uint64 addr, uint32 val) {
+    *(volatile uint32 *)addr = val;
+}
+
+static inline uint32 plic_read(uint64 addr) {
+    return *(volatile uint32 *)addr;
+}
+
+// 设置hart对中断源irq的使能位，调用者持有plic_lock
+static void plic_enable(int hart, int irq, int on) {
+    uint64 reg = PLIC_SENABLE(hart, irq);
+    uint32 bit = 1U << (irq % 32);
+    uint32 val = plic_read(reg);
+
+    plic_write(reg, on ? (val | bit) : (val & ~bit));
+}
+
+void plic_init() {
+    for (int irq = 1; irq < PLIC_NSOURCES; irq++) {
+        plic_write(PLIC_PRIORITY(irq), 0);
+    }
+}
+
+void plic_init_hart() {
+    int hart = cpuid();
+    uint64 flags = spin_lock_irqsave(&plic_lock);
+
+    // 在本hart启动之前注册、路由到本hart的中断源
+    for (int irq = 1; irq < PLIC_NSOURCES; irq++) {
+        plic_enable(hart, irq, irq_descs[irq].handler && ((irq_descs[irq].hart_mask >> hart) & 1));
+    }
+    plic_write(PLIC_STHRESHOLD(hart), 0);
+    spin_unlock_irqrestore(&plic_lock, flags);
+}
+
+int request_irq(int irq, irq_handler_t fn, void *arg, int priority, uint64 hart_mask) {
+    if (irq <= 0 || irq >= PLIC_NSOURCES || !fn || priority < 1 || priority > PLIC_PRIO_MAX) {
+        return -1;
+    }
+    uint64 flags = spin_lock_irqsave(&plic_lock);
+    struct irq_desc *d = &irq_descs[irq];
+    if (d->handler) {
+        spin_unlock_irqrestore(&plic_lock, flags);
+        return -1;
+    }
+    d->handler = fn;
+    d->arg = arg;
+    d->hart_mask = hart_mask & CPU_MASK_ALL;
+    plic_write(PLIC_PRIORITY(irq), priority);
+    // 还没有启动的hart在plic_init_hart中使能
+    for (int hart = 0; hart < NCPU; hart++) {
+        if ((d->hart_mask >> hart) & 1) {
+            plic_enable(hart, irq, 1);
+        }
+    }
+    spin_unlock_irqrestore(&plic_lock, flags);
+    return 0;
+}
+
+void free_irq(int irq) {
+    if (irq <= 0 || irq >= PLIC_NSOURCES) {
+        return;
+    }
+    uint64 flags = spin_lock_irqsave(&plic_lock);
+    for (int hart = 0; hart < NCPU; hart++) {
+        plic_enable(hart, irq, 0);
+    }
+    plic_write(PLIC_PRIORITY(irq), 0);
+    irq_descs[irq].handler = NULL;
+    irq_descs[irq].hart_mask = 0;
+    spin_unlock_irqrestore(&plic_lock, flags);
+}
+
+int plic_set_priority(int irq, int priority) {
+    if (irq <= 0 || irq >= PLIC_NSOURCES || priority < 1 || priority > PLIC_PRIO_MAX ||
+        !irq_descs[irq].handler) {
+        return -1;
+    }
+    plic_write(PLIC_PRIORITY(irq), priority);
+    return 0;
+}
+
+void plic_set_threshold(int threshold) {
+    plic_write(PLIC_STHRESHOLD(cpuid()), threshold);
+}
+
+int plic_dispatch() {
+    uint64 claim = PLIC_SCLAIM(cpuid());
+    int handled = 0;
+    int irq;
+
+    while ((irq = plic_read(claim)) != 0) {
+        struct irq_desc *d = irq < PLIC_NSOURCES ? &irq_descs[irq] : NULL;
+        if (d && d->handler) {
+            d->handler(irq, d->arg);
+            __sync_fetch_and_add(&d->count, 1);
+        } else {
+            // 没有驱动的中断源：屏蔽它，避免电平触发的中断反复到达
+            __sync_fetch_and_add(&spurious, 1);
+            if (irq < PLIC_NSOURCES) {
+                plic_write(PLIC_PRIORITY(irq), 0);
+            }
+        }
+        plic_write(claim, irq);
+        handled++;
+    }
+    return handled;
+}
+
+uint64 plic_irq_count(int irq) {
+    return irq > 0 && irq < PLIC_NSOURCES ? irq_descs[irq].count : 0;
+}
+
+uint64 plic_spurious_count() {
+    return spurious;
+}
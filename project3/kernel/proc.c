@@ -0,0 +1,475 @@
+// proc.c - 任务控制块管理
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/trap.h"
+#include "../include/util.h"
+#include "../include/exec.h"
+#include "../include/file.h"
+#include "../include/sched.h"
+#include "../include/memlayout.h"
+#include "../include/console.h"
+#include "../include/futex.h"
+#include "../include/ipi.h"
+#include "../include/vdso.h"
+#include "../include/uaccess.h"
+#include "../include/syscall.h"
+
+struct cpu cpus[NCPU];
+struct task tasks[NTASK];
+
+// 地址空间池，每个任务最多使用一个
+static struct mm mms[NTASK];
+
+// pid 0 留给第一个创建的空闲任务，init任务为pid 1
+static int next_pid = 0;
+
+// 获取当前hart
+struct cpu *mycpu(void) {
+    return &cpus[cpuid()];
+}
+
+// 获取当前任务
+struct task *current_task(void) {
+    return mycpu()->cur;
+}
+
+// 分配一个任务控制块，返回的任务处于TASK_NEW状态
+struct task *task_alloc(const char *name) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->state != TASK_UNUSED) {
+            continue;
+        }
+
+        memset(t, 0, sizeof(*t));
+        t->state = TASK_NEW;
+        t->pid = next_pid++;
+        t->tgid = t->pid;
+        t->policy = SCHED_CLASS_FAIR;
+        t->frame = t->tf.regs;
+        t->fpu_cpu = -1;
+        // 默认不使用隔离的hart；先属于创建它的hart，唤醒时再选择
+        t->cpus_allowed = CPU_MASK_ALL & ~CPU_ISOLATED_MASK;
+        t->cpu = cpuid();
+        for (int j = 0; j < TASK_NAME_LEN - 1 && name[j]; j++) {
+            t->name[j] = name[j];
+        }
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return t;
+    }
+
+    spin_unlock_irqrestore(&sched_lock, flags);
+    console_printf_PROC("任务表已满\n");
+    return NULL;
+}
+
+// 释放任务控制块（调用者持有sched_lock），文件和地址空间必须已经释放
+static void task_release_locked(struct task *t) {
+    t->parent = NULL;
+    t->state = TASK_UNUSED;
+}
+
+// 释放任务控制块及其地址空间
+// 调用者不能持有sched_lock，且必须保证当前satp不再指向该任务的页表
+void task_free(struct task *t) {
+    fd_close_all(t);
+    if (t->mm) {
+        mm_put(t->mm);
+        t->mm = NULL;
+    }
+
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    task_release_locked(t);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 从initramfs加载程序，创建用户态任务
+struct task *task_create_user(const char *path, char *const argv[]) {
+    struct task *t = task_alloc(path);
+    if (!t) {
+        return NULL;
+    }
+
+    // exec_load设置页表、入口、栈和参数，SPP=0：sret返回到U模式
+    if (exec_load(t, path, argv, NULL, 0) < 0) {
+        task_free(t);
+        return NULL;
+    }
+
+    // 标准输入、输出、错误都指向控制台
+    struct file *f = file_console();
+    if (!f) {
+        task_free(t);
+        return NULL;
+    }
+    t->ofile[0] = f;
+    t->ofile[1] = filedup(f);
+    t->ofile[2] = filedup(f);
+    sched_wakeup(t);
+
+    console_printf_PROC("创建用户任务 %s (pid=%d), 入口=0x%lx, 栈=0x%lx\n",
+                        t->name, t->pid, t->sepc, t->tf.regs[REG_SP]);
+    return t;
+}
+
+// 创建S模式内核任务，调用者完成设置后用sched_wakeup使其就绪
+struct task *task_create_kernel(const char *name, void (*fn)(void), uint64 stack_top) {
+    struct task *t = task_alloc(name);
+    if (!t) {
+        return NULL;
+    }
+
+    t->sepc = (uint64)fn;
+    t->tf.regs[REG_SP] = stack_top;
+    // SPP=1：sret返回到S模式，SPIE=1：返回后开中断
+    t->sstatus = SSTATUS_SPP | SSTATUS_SPIE;
+
+    console_printf_PROC("创建内核任务 %s (pid=%d)\n", t->name, t->pid);
+    return t;
+}
+
+// 设置父进程并加入就绪队列
+static void task_start_child(struct task *c, struct task *p) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    c->parent = p;
+    sched_wakeup_locked(c);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 复制当前任务
+int task_fork(void) {
+    struct task *p = current_task();
+
+    if (!p->mm) {
+        return -1;      // 内核任务不能fork
+    }
+    struct task *c = task_alloc(p->name);
+    if (!c) {
+        return -1;
+    }
+
+    // 复制地址空间：可写页逐页复制，映射自initramfs的只读页共享
+    pagetable_t pt = uvmcreate();
+    if (!pt) {
+        task_free(c);
+        return -1;
+    }
+    c->mm = mm_create(pt);
+    if (!c->mm) {
+        uvmfree(pt);
+        task_free(c);
+        return -1;
+    }
+    c->mm->brk = p->mm->brk;
+    // 共享页在堆中，子进程得到一份副本
+    c->mm->ring = p->mm->ring;
+    if (uvmcopy(p->mm->pagetable, pt) < 0) {
+        task_free(c);
+        return -1;
+    }
+    vdso_set_pid(pt, c->tgid);
+
+    // 子进程从同一个系统调用返回，sepc已指向ecall的下一条指令
+    // 只复制调用fork的线程，tp保持不变，TLS在复制的地址空间中
+    memcpy(c->tf.regs, mycpu()->trap_regs, sizeof(c->tf.regs));
+    c->tf.regs[REG_A0] = 0;
+    c->sepc = r_sepc();
+    c->sstatus = SSTATUS_SPIE;
+    fpu_fork(c, p);
+    c->cpus_allowed = p->cpus_allowed;
+    c->traced = p->traced;
+    fd_copy(c, p);
+    task_start_child(c, p);
+
+    console_printf_PROC("fork: pid %d -> pid %d\n", p->pid, c->pid);
+    return c->pid;
+}
+
+// 创建共享地址空间的线程
+int task_clone(uint64 fn, uint64 arg, uint64 stack, uint64 tls, uint64 ctid) {
+    struct task *p = current_task();
+
+    if (!p->mm || stack % 16 != 0) {
+        return -1;
+    }
+    struct task *c = task_alloc(p->name);
+    if (!c) {
+        return -1;
+    }
+
+    // 线程属于同一进程：getpid相同，退出时不需要父进程wait
+    c->tgid = p->tgid;
+    c->mm = mm_get(p->mm);
+    c->tf.regs[REG_SP] = stack;
+    c->tf.regs[REG_TP] = tls;
+    c->tf.regs[REG_A0] = arg;
+    c->sepc = fn;
+    c->sstatus = SSTATUS_SPIE;
+    c->clear_tid = ctid;
+    // 描述符表不共享，线程得到创建时的一份副本
+    c->cpus_allowed = p->cpus_allowed;
+    c->traced = p->traced;
+    fd_copy(c, p);
+    sched_wakeup(c);
+
+    console_printf_PROC("clone: pid %d 创建线程 %d\n", p->tgid, c->pid);
+    return c->pid;
+}
+
+// 在子进程上执行spawn的文件操作
+static int spawn_file_actions_apply(struct task *c, const struct spawn_file_actions *fa) {
+    char path[MAXPATH];
+
+    for (int i = 0; i < fa->count; i++) {
+        const struct spawn_action *a = &fa->actions[i];
+        struct file *f;
+
+        switch (a->type) {
+            case SPAWN_FA_CLOSE:
+                fd_close(c, a->fd);
+                break;
+            case SPAWN_FA_DUP2:
+                if (fd_dup2(c, a->fd, a->newfd) < 0) {
+                    return -1;
+                }
+                break;
+            case SPAWN_FA_OPEN:
+                // 路径在父进程的用户内存中，子进程开始运行前当前地址空间仍是父进程的
+                if (a->fd < 0 || a->fd >= NOFILE ||
+                    strncpy_from_user(path, (uint64)a->path, MAXPATH) < 0 ||
+                    (f = file_open(path, a->flags)) == NULL) {
+                    return -1;
+                }
+                fd_close(c, a->fd);
+                c->ofile[a->fd] = f;
+                break;
+            default:
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// 直接从程序文件创建子进程
+int task_spawn(const char *path, char *const argv[], char *const envp[],
+               const struct spawn_file_actions *ufa) {
+    struct task *p = current_task();
+    struct spawn_file_actions fa;
+
+    // 文件操作在用户空间，先复制一份再检查
+    if (ufa) {
+        if (copy_from_user(&fa, (uint64)ufa, sizeof(fa)) < 0 ||
+            fa.count < 0 || fa.count > SPAWN_MAX_ACTIONS) {
+            return -1;
+        }
+    }
+
+    struct task *c = task_alloc(path);
+    if (!c) {
+        return -1;
+    }
+
+    // 新地址空间直接由ELF建立，argv/envp在父进程地址空间中，通过uaccess读取
+    if (exec_load(c, path, argv, envp, 1) < 0) {
+        task_free(c);
+        return -1;
+    }
+    c->cpus_allowed = p->cpus_allowed;
+    c->traced = p->traced;
+    fd_copy(c, p);
+    if (ufa && spawn_file_actions_apply(c, &fa) < 0) {
+        task_free(c);
+        return -1;
+    }
+    task_start_child(c, p);
+
+    console_printf_PROC("spawn: pid %d -> pid %d (%s)\n", p->pid, c->pid, path);
+    return c->pid;
+}
+
+// 等待任意子进程退出
+int task_wait(uint64 status) {
+    struct task *p = current_task();
+    int have_kids = 0;
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *c = &tasks[i];
+        if (c->state == TASK_UNUSED || c->parent != p) {
+            continue;
+        }
+        have_kids = 1;
+        // 还在切换过程中的子进程等task_exited之后再回收
+        if (c->state == TASK_ZOMBIE && !c->on_cpu) {
+            int pid = c->pid;
+            int xstate = c->xstate;
+            task_release_locked(c);
+            spin_unlock_irqrestore(&sched_lock, flags);
+            // 在锁外复制：status无效或只读时子进程已被回收，与Linux的EFAULT一样返回-1
+            if (status && copy_to_user(status, &xstate, sizeof(xstate)) < 0) {
+                return -1;
+            }
+            return pid;
+        }
+    }
+    if (!have_kids) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+
+    // 阻塞：子进程退出后task_exited唤醒父进程，唤醒后重新执行wait回收子进程。
+    // 检查和睡眠都在sched_lock内，不会丢失唤醒
+    p->waiting = 1;
+    p->wakeup_time = ~0ULL;
+    p->state = TASK_SLEEPING;
+    mycpu()->need_resched = 1;
+    syscall_restart();
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return 0;
+}
+
+// 当前任务退出
+void task_exit(int code) {
+    struct task *t = current_task();
+
+    fd_close_all(t);
+
+    // 被exit_group唤醒的线程可能还在futex等待队列中
+    futex_cancel(t);
+
+    // join通过clear_tid得知线程已退出，此时线程不再使用自己的栈
+    if (t->clear_tid) {
+        int zero = 0;
+        copy_to_user(t->clear_tid, &zero, sizeof(zero));
+        futex_wake(t->clear_tid, 1);
+    }
+
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    t->xstate = code;
+
+    // 子进程成为孤儿：已退出的直接释放，其余退出时自行释放
+    for (int i = 0; i < NTASK; i++) {
+        struct task *c = &tasks[i];
+        if (c->state == TASK_UNUSED || c->parent != t) {
+            continue;
+        }
+        c->parent = NULL;
+        if (c->state == TASK_ZOMBIE && !c->on_cpu) {
+            task_release_locked(c);
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+
+    sched_exit(code);
+}
+
+// 当前进程的其他线程退出（exit和exec使用）
+void task_kill_threads(void) {
+    struct task *t = current_task();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    // 其他线程在下次返回用户态前退出，睡眠中的线程先唤醒
+    for (int i = 0; i < NTASK; i++) {
+        struct task *o = &tasks[i];
+        if (o == t || o->tgid != t->tgid || !o->mm ||
+            o->state == TASK_UNUSED || o->state == TASK_ZOMBIE) {
+            continue;
+        }
+        o->killed = 1;
+        if (o->state == TASK_SLEEPING) {
+            o->waiting = 0;
+            sched_wakeup_locked(o);
+        } else if (o->on_cpu && o->cpu != cpuid()) {
+            // 正在其他hart上运行：通过核间中断让它尽快返回用户态前退出
+            ipi_resched(o->cpu);
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 当前进程的所有线程退出
+void task_exit_group(int code) {
+    task_kill_threads();
+    task_exit(code);
+}
+
+// 已退出的任务被切换出去后由schedule调用，调用者持有sched_lock
+void task_exited(struct task *t) {
+    struct task *p = t->parent;
+
+    if (t->mm) {
+        mm_put(t->mm);
+        t->mm = NULL;
+    }
+
+    // 父进程正阻塞在wait中：唤醒它重新执行wait，由它回收子进程并写入退出码
+    if (p && p->waiting) {
+        p->waiting = 0;
+        sched_wakeup_locked(p);
+        return;
+    }
+
+    // 无人等待则立即释放，否则保留退出码直到父进程wait
+    if (!p) {
+        task_release_locked(t);
+    }
+}
+
+struct mm *mm_create(pagetable_t pagetable) {
+    for (int i = 0; i < NTASK; i++) {
+        struct mm *mm = &mms[i];
+        if (__sync_bool_compare_and_swap(&mm->ref, 0, 1)) {
+            spin_init(&mm->lock, "mm");
+            spin_init(&mm->ring_lock, "ring");
+            mm->ring = 0;
+            mm->pagetable = pagetable;
+            mm->brk = USER_BASE;
+            return mm;
+        }
+    }
+    return NULL;
+}
+
+struct mm *mm_get(struct mm *mm) {
+    __sync_fetch_and_add(&mm->ref, 1);
+    return mm;
+}
+
+void mm_put(struct mm *mm) {
+    // 引用计数归零后该mm不会再被任何任务使用，可以在锁外释放
+    pagetable_t pt = mm->pagetable;
+    if (__sync_sub_and_fetch(&mm->ref, 1) == 0) {
+        uvmfree(pt);
+    }
+}
+
+uint64 mm_sbrk(struct mm *mm, int64 n) {
+    uint64 flags = spin_lock_irqsave(&mm->lock);
+    uint64 old = mm->brk;
+    uint64 new = old + n;
+
+    // 只支持增长；堆与主线程栈之间保留保护页
+    if (n < 0 || new > USER_HEAP_LIMIT) {
+        spin_unlock_irqrestore(&mm->lock, flags);
+        return -1;
+    }
+    for (uint64 va = PGROUNDUP(old); va < new; va += PGSIZE) {
+        void *page = kalloc_zeroed();
+        if (!page || mappages(mm->pagetable, va, PGSIZE, (uint64)page, PTE_U | PTE_R | PTE_W) < 0) {
+            // 分配失败时堆顶只前进到已映射的部分
+            if (page) {
+                kfree(page);
+            }
+            mm->brk = va > old ? va : old;
+            spin_unlock_irqrestore(&mm->lock, flags);
+            return -1;
+        }
+    }
+    mm->brk = new;
+    spin_unlock_irqrestore(&mm->lock, flags);
+    return old;
+}
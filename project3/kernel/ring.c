@@ -0,0 +1,131 @@
+// ring.c - 批量系统调用的提交/完成队列
+//
+// 共享页从进程的堆中分配（sbrk），随地址空间一起释放，fork时子进程
+// 得到一份私有的副本。内核在调用ring_enter的进程上下文中处理提交，
+// 通过SUM直接访问共享页；队列下标来自用户内存，每次使用前都取模。
+//
+// 同一进程的多个线程可能同时调用ring_enter，由mm->ring_lock串行化。
+// 持有ring_lock时不能阻塞：READ和WRITE以非阻塞方式执行，
+// SLEEP在释放ring_lock之后才让任务睡眠（锁顺序：ring_lock -> ftable/console）。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/file.h"
+#include "../include/ring.h"
+#include "../include/vm.h"
+#include "../include/console.h"
+#include "../include/uaccess.h"
+
+uint64 ring_setup(void) {
+    struct mm *mm = current_task()->mm;
+
+    if (!mm) {
+        return -1;
+    }
+
+    uint64 flags = spin_lock_irqsave(&mm->ring_lock);
+    if (!mm->ring) {
+        // 从页边界开始分配一整页，新分配的堆页已清零
+        uint64 brk = mm->brk;
+        uint64 va = mm_sbrk(mm, PGROUNDUP(brk) - brk + PGSIZE);
+        if (va != (uint64)-1) {
+            mm->ring = PGROUNDUP(va);
+            console_printf_PROC("pid %d: 提交/完成队列位于 0x%lx\n",
+                                current_task()->tgid, mm->ring);
+        }
+    }
+    uint64 ring = mm->ring;
+    spin_unlock_irqrestore(&mm->ring_lock, flags);
+    return ring ? ring : (uint64)-1;
+}
+
+// 执行一个提交项，返回结果
+static int64 ring_exec(struct task *t, struct ring_sqe *sqe) {
+    struct file *f;
+
+    switch (sqe->op) {
+        case RING_OP_NOP:
+            return 0;
+        case RING_OP_WRITE:
+            f = fd_get(sqe->fd);
+            // 持有ring_lock，不能阻塞：发送缓冲区满时只写入放得下的部分
+            return f ? filewrite(f, (const void *)sqe->addr, sqe->len, 1) : -1;
+        case RING_OP_READ:
+            f = fd_get(sqe->fd);
+            // 持有ring_lock，不能阻塞：控制台没有输入时返回-1
+            return f ? fileread(f, (void *)sqe->addr, sqe->len, 1) : -1;
+        case RING_OP_OPEN: {
+            char path[MAXPATH];
+            if (strncpy_from_user(path, sqe->addr, sizeof(path)) < 0) {
+                return -1;
+            }
+            f = file_open(path, (int)sqe->len);
+            if (!f) {
+                return -1;
+            }
+            int fd = fd_install(t, f);
+            if (fd < 0) {
+                fileclose(f);
+            }
+            return fd;
+        }
+        case RING_OP_CLOSE:
+            return fd_close(t, sqe->fd);
+        default:
+            return -1;
+    }
+}
+
+int ring_enter(uint32 to_submit) {
+    struct task *t = current_task();
+    struct mm *mm = t->mm;
+    uint64 sleep_ms = 0;
+    int sleep = 0;
+    int done = 0;
+
+    if (!mm || !mm->ring) {
+        return -1;
+    }
+    // 下标来自用户内存，限制每次调用处理的数量，避免长时间关中断
+    if (to_submit > RING_ENTRIES) {
+        to_submit = RING_ENTRIES;
+    }
+
+    struct ring_shared *r = (struct ring_shared *)mm->ring;
+    uint64 flags = spin_lock_irqsave(&mm->ring_lock);
+    while ((uint32)done < to_submit && r->sq_head != r->sq_tail) {
+        // 完成队列已满：剩下的提交留到用户取走结果之后
+        if (r->cq_tail - r->cq_head >= RING_ENTRIES) {
+            break;
+        }
+
+        struct ring_sqe sqe = r->sqes[r->sq_head % RING_ENTRIES];
+        struct ring_cqe *cqe = &r->cqes[r->cq_tail % RING_ENTRIES];
+
+        cqe->user_data = sqe.user_data;
+        if (sqe.op == RING_OP_SLEEP) {
+            sleep = 1;
+            sleep_ms = sqe.len;
+            cqe->res = 0;
+        } else {
+            cqe->res = ring_exec(t, &sqe);
+        }
+        // 先写完成项再推进下标，用户看到新的cq_tail时结果已经可见
+        __sync_synchronize();
+        r->cq_tail++;
+        r->sq_head++;
+        done++;
+
+        if (sqe.op == RING_OP_SLEEP) {
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&mm->ring_lock, flags);
+
+    if (sleep) {
+        sched_sleep(sleep_ms);
+    }
+    return done;
+}
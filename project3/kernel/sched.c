@@ -0,0 +1,757 @@
+// sched.c - 调度器：EDF实时调度类 + 公平调度类 + 空闲任务
+//
+// 任务切换发生在trap返回之前：schedule()记下当前任务保存寄存器的位置
+// （用户任务是任务控制块中的trap帧，S模式任务是它自己的栈），返回下一个
+// 任务保存的寄存器数组，trap_vector从那里恢复寄存器并sret，不需要复制。
+//
+// 所有hart共享一张任务表，由sched_lock保护。正在某个hart上运行的任务
+// 带有on_cpu标记，其他hart不会选中它，直到它的上下文保存完毕。
+//
+// 每个任务属于一个hart（task->cpu），hart只从属于自己的任务中选择，
+// 相当于按hart划分的就绪队列。任务在以下情况下换到其他hart：
+//   - 唤醒时所属hart正忙、任务缓存已冷，而有空闲的hart；
+//   - hart即将空闲时，从正忙的hart上取走一个等待中的任务；
+//   - 周期负载均衡：从负载最重的hart迁入缓存最冷的等待任务。
+// 任务被放到其他hart时通过核间中断通知该hart重新调度。
+// 隔离的hart不参与动态迁移，只运行所属的任务。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/timer.h"
+#include "../include/trap.h"
+#include "../include/util.h"
+#include "../include/vm.h"
+#include "../include/console.h"
+#include "../include/ipi.h"
+
+#define IDLE_STACK_SIZE 4096
+
+struct spinlock sched_lock = SPINLOCK_INIT("sched");
+
+volatile uint64 cpu_online_mask;
+
+// 空闲任务的栈
+static uint8 idle_stack[NCPU][IDLE_STACK_SIZE] __attribute__((aligned(16)));
+
+// 已准入的EDF带宽之和
+static uint64 edf_total_bw = 0;
+
+// 所有已退出EDF任务的错过截止时间次数
+static uint64 edf_exited_misses = 0;
+
+// 空闲任务：等待中断
+static void idle_loop(void) {
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+// 初始化调度器，创建空闲任务
+void sched_init() {
+    int id = cpuid();
+    struct task *idle = task_create_kernel("idle",
+                                           idle_loop,
+                                           (uint64)&idle_stack[id][IDLE_STACK_SIZE]);
+    if (!idle) {
+        panic("无法创建空闲任务");
+    }
+    idle->policy = SCHED_CLASS_IDLE;
+    idle->cpus_allowed = 1ULL << id;
+    mycpu()->idle = idle;
+    sched_wakeup(idle);
+    __sync_fetch_and_or(&cpu_online_mask, 1ULL << id);
+    console_printf_SCHED("调度器初始化完成, hart %d%s\n", id, cpu_isolated(id) ? " (隔离)" : "");
+}
+
+// 开始在当前hart上运行任务t
+void sched_start(struct task *t) {
+    struct cpu *c = mycpu();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    c->cur = t;
+    t->state = TASK_RUNNING;
+    t->on_cpu = 1;
+    t->cpu = cpuid();
+    vm_switch(t->mm ? t->mm->pagetable : kernel_pagetable);
+    t->exec_start = r_time();
+    timer_reprogram();
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 公平调度类中最小的vruntime，用于新唤醒任务的补偿
+static uint64 fair_min_vruntime(struct task *skip) {
+    uint64 min = ~0ULL;
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t == skip || t->policy != SCHED_CLASS_FAIR) {
+            continue;
+        }
+        if ((t->state == TASK_RUNNABLE || t->state == TASK_RUNNING) && t->vruntime < min) {
+            min = t->vruntime;
+        }
+    }
+    return min;
+}
+
+// 开始EDF任务的下一个作业
+static void edf_replenish(struct task *t, uint64 now) {
+    struct edf_entity *e = &t->edf;
+
+    // 上一个作业未完成就到了新周期，且截止时间已过
+    if (!e->job_done && !e->missed && now > e->abs_deadline) {
+        e->nr_misses++;
+        console_printf_SCHED("pid %d 错过截止时间 (预算耗尽)\n", t->pid);
+    }
+
+    // 跳过已经完全错过的周期
+    while (e->next_release + e->period <= now) {
+        e->next_release += e->period;
+    }
+
+    e->abs_deadline = e->next_release + e->deadline;
+    e->next_release += e->period;
+    e->remaining = e->runtime;
+    e->throttled = 0;
+    e->job_done = 0;
+    e->missed = 0;
+}
+
+// hart是否在线且只运行空闲任务
+static int cpu_idle(int id) {
+    return ((cpu_online_mask >> id) & 1) && cpus[id].cur == cpus[id].idle;
+}
+
+// 任务t能否放到hart id上：亲和性允许、hart在线且不是隔离的hart（动态迁移用）
+static int task_can_migrate_to(struct task *t, int id) {
+    return ((t->cpus_allowed & cpu_online_mask) >> id) & 1 && !cpu_isolated(id);
+}
+
+// 离开CPU不久的任务，数据可能还在原hart的缓存中
+static int task_cache_hot(struct task *t, uint64 now) {
+    return now - t->last_ran < US_TO_TICKS(MIGRATION_COST_US);
+}
+
+// 各hart的负载：属于该hart的可运行任务数（不含空闲任务）
+static void cpu_loads(int load[NCPU]) {
+    for (int i = 0; i < NCPU; i++) {
+        load[i] = 0;
+    }
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if ((t->state == TASK_RUNNABLE || t->state == TASK_RUNNING) &&
+            t->policy != SCHED_CLASS_IDLE) {
+            load[t->cpu]++;
+        }
+    }
+}
+
+// 把任务t划归hart dst
+static void migrate_task(struct task *t, int dst) {
+    if (t->cpu == dst) {
+        return;
+    }
+    console_printf_SCHED("pid %d: hart %d -> hart %d\n", t->pid, t->cpu, dst);
+    t->cpu = dst;
+    t->nr_migrations++;
+    cpus[dst].nr_migrations++;
+}
+
+// 所属hart不在亲和性掩码中时，换到允许的hart中负载最轻的一个
+static int select_allowed_cpu(struct task *t) {
+    int load[NCPU];
+    int best = -1;
+
+    cpu_loads(load);
+    for (int i = 0; i < NCPU; i++) {
+        if (!(((t->cpus_allowed & cpu_online_mask) >> i) & 1)) {
+            continue;
+        }
+        if (best < 0 || load[i] < load[best]) {
+            best = i;
+        }
+    }
+    // 允许的hart都还没上线：先放在掩码中的第一个hart上
+    for (int i = 0; best < 0 && i < NCPU; i++) {
+        if ((t->cpus_allowed >> i) & 1) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// 为被唤醒的任务选择hart：所属hart空闲或任务缓存还热时留在原处，
+// 否则优先当前hart，其次其他空闲的hart
+static int select_task_cpu(struct task *t, uint64 now) {
+    int prev = t->cpu;
+
+    if (!((t->cpus_allowed >> prev) & 1)) {
+        prev = select_allowed_cpu(t);
+    }
+    if (t->on_cpu || cpu_idle(prev) || task_cache_hot(t, now)) {
+        return prev;
+    }
+    for (int i = 0; i < NCPU; i++) {
+        int id = (cpuid() + i) % NCPU;
+        if (task_can_migrate_to(t, id) && cpu_idle(id)) {
+            return id;
+        }
+    }
+    return prev;
+}
+
+// 通知hart id重新调度
+static void resched_cpu(int id) {
+    if (id == cpuid()) {
+        mycpu()->need_resched = 1;
+    } else if ((cpu_online_mask >> id) & 1) {
+        ipi_resched(id);
+    }
+}
+
+// 加入就绪队列，调用者持有sched_lock
+void sched_wakeup_locked(struct task *t) {
+    if (t->policy == SCHED_CLASS_FAIR) {
+        uint64 min = fair_min_vruntime(t);
+        if (min != ~0ULL && t->vruntime < min) {
+            t->vruntime = min;
+        }
+    }
+    t->state = TASK_RUNNABLE;
+    migrate_task(t, select_task_cpu(t, r_time()));
+    resched_cpu(t->cpu);
+}
+
+void sched_wakeup(struct task *t) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    sched_wakeup_locked(t);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 唤醒到期的睡眠任务
+// kworker也通过把wakeup_time置0来唤醒，这样中断上下文不需要获取sched_lock
+static void wake_expired(uint64 now) {
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->state == TASK_SLEEPING && t->wakeup_time <= now) {
+            sched_wakeup_locked(t);
+        }
+    }
+}
+
+// 把运行时间记到当前任务上，并检查EDF预算
+static void update_curr(struct task *t, uint64 now) {
+    uint64 delta = now - t->exec_start;
+
+    t->exec_start = now;
+    t->sum_exec += delta;
+    if (t->policy != SCHED_CLASS_IDLE) {
+        mycpu()->busy_time += delta;
+    }
+
+    if (t->policy == SCHED_CLASS_FAIR) {
+        t->vruntime += delta;
+    } else if (t->policy == SCHED_CLASS_EDF && !t->edf.throttled) {
+        if (delta >= t->edf.remaining) {
+            // 预算耗尽：节流到下一个周期
+            t->edf.remaining = 0;
+            t->edf.throttled = 1;
+            mycpu()->need_resched = 1;
+        } else {
+            t->edf.remaining -= delta;
+        }
+    }
+}
+
+// 周期负载均衡：负载最重的hart比本hart多至少两个任务时，迁入其中一个
+// 等待中的任务。优先选择离开CPU最久（缓存最冷）的任务，缓存还热的任务
+// 只在负载相差很大时迁移
+static void load_balance(uint64 now) {
+    int load[NCPU];
+    int me = cpuid();
+    int busiest = -1;
+    struct task *best = NULL;
+
+    cpu_loads(load);
+    for (int i = 0; i < NCPU; i++) {
+        if (i == me || !((cpu_online_mask >> i) & 1) || cpu_isolated(i)) {
+            continue;
+        }
+        if (busiest < 0 || load[i] > load[busiest]) {
+            busiest = i;
+        }
+    }
+    if (busiest < 0 || load[busiest] - load[me] < 2) {
+        return;
+    }
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->cpu != busiest || t->state != TASK_RUNNABLE || t->on_cpu ||
+            t->policy == SCHED_CLASS_IDLE || !task_can_migrate_to(t, me)) {
+            continue;
+        }
+        if (!best || t->last_ran < best->last_ran) {
+            best = t;
+        }
+    }
+    if (!best || (task_cache_hot(best, now) && load[busiest] - load[me] < 3)) {
+        return;
+    }
+    migrate_task(best, me);
+    mycpu()->need_resched = 1;
+}
+
+// 本hart即将空闲：从正忙的hart上取走一个等待中的任务，
+// 优先选择缓存已冷的任务；缓存还热的任务只在它前面还有其他等待任务时取走
+static struct task *steal_task(uint64 now) {
+    int waiting[NCPU];
+    int me = cpuid();
+    struct task *best = NULL;
+
+    if (cpu_isolated(me)) {
+        return NULL;
+    }
+    for (int i = 0; i < NCPU; i++) {
+        waiting[i] = 0;
+    }
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->state == TASK_RUNNABLE && !t->on_cpu && t->policy != SCHED_CLASS_IDLE) {
+            waiting[t->cpu]++;
+        }
+    }
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->cpu == me || t->state != TASK_RUNNABLE || t->on_cpu ||
+            t->policy == SCHED_CLASS_IDLE || !task_can_migrate_to(t, me)) {
+            continue;
+        }
+        if (t->policy == SCHED_CLASS_EDF && t->edf.throttled) {
+            continue;
+        }
+        // 所属hart空闲时它自己会运行这个任务
+        if (cpu_idle(t->cpu)) {
+            continue;
+        }
+        if (task_cache_hot(t, now) && waiting[t->cpu] < 2) {
+            continue;
+        }
+        if (!best || t->last_ran < best->last_ran) {
+            best = t;
+        }
+    }
+    if (best) {
+        migrate_task(best, me);
+    }
+    return best;
+}
+
+// 时钟中断中调用
+void sched_tick(uint64 now) {
+    struct cpu *c = mycpu();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    wake_expired(now);
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+
+        // 新周期释放：yield后睡眠的任务或预算耗尽被节流的任务开始下一个作业
+        if (t->policy == SCHED_CLASS_EDF &&
+            (t->state == TASK_RUNNABLE || t->state == TASK_RUNNING) &&
+            (t->edf.throttled || t->edf.job_done) && t->edf.next_release <= now) {
+            edf_replenish(t, now);
+            c->need_resched = 1;
+        }
+    }
+
+    if (c->cur) {
+        update_curr(c->cur, now);
+    }
+
+    if (now >= c->next_balance && !cpu_isolated(cpuid())) {
+        c->next_balance = now + US_TO_TICKS(BALANCE_INTERVAL_US);
+        load_balance(now);
+    }
+
+    // 时间片轮转：每次时钟中断都重新选择
+    c->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 任务t能否在当前hart上运行
+static int task_can_run_here(struct task *t, struct cpu *c) {
+    if (t->state != TASK_RUNNABLE && t->state != TASK_RUNNING) {
+        return 0;
+    }
+    // 正在其他hart上运行或尚未保存完上下文
+    if (t->on_cpu && t != c->cur) {
+        return 0;
+    }
+    return t->cpu == cpuid() && ((t->cpus_allowed >> cpuid()) & 1);
+}
+
+// 选择下一个任务：EDF（最早截止时间优先） > 公平（最小vruntime） > 空闲
+static struct task *pick_next_task(uint64 now) {
+    struct cpu *c = mycpu();
+    struct task *best = NULL;
+
+    c->nr_running = 0;
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (!task_can_run_here(t, c)) {
+            continue;
+        }
+        if (t->policy != SCHED_CLASS_IDLE) {
+            c->nr_running++;
+        }
+        if (t->policy == SCHED_CLASS_EDF && t->edf.throttled) {
+            continue;
+        }
+        if (!best || t->policy > best->policy) {
+            best = t;
+        } else if (t->policy == best->policy) {
+            if (t->policy == SCHED_CLASS_EDF && t->edf.abs_deadline < best->edf.abs_deadline) {
+                best = t;
+            } else if (t->policy == SCHED_CLASS_FAIR && t->vruntime < best->vruntime) {
+                best = t;
+            }
+        }
+    }
+
+    if (!best || best->policy == SCHED_CLASS_IDLE) {
+        best = steal_task(now);
+    }
+    if (!best) {
+        best = c->idle;
+    }
+    return best;
+}
+
+// 从trap返回前调用，返回要恢复的寄存器数组
+uint64 *schedule(uint64 *regs) {
+    struct cpu *c = mycpu();
+    struct task *prev = c->cur;
+    struct task *next;
+    uint64 *frame = regs;
+    uint64 now = r_time();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    c->need_resched = 0;
+    if (prev && prev->state != TASK_ZOMBIE) {
+        update_curr(prev, now);
+    }
+
+    wake_expired(now);
+    next = pick_next_task(now);
+    if (next != prev) {
+        if (prev && prev->state != TASK_ZOMBIE) {
+            // 保存被切换任务的上下文：寄存器已在regs中，只记录位置
+            prev->frame = regs;
+            prev->sepc = r_sepc();
+            prev->sstatus = r_sstatus() & (SSTATUS_SPP | SSTATUS_SPIE);
+            prev->last_ran = now;
+            if (prev->state == TASK_RUNNING) {
+                prev->state = TASK_RUNNABLE;
+            }
+        }
+
+        // 浮点寄存器按需保存，FS决定next第一次使用浮点时是否需要加载
+        fpu_switch(prev, next);
+
+        // 恢复下一个任务的上下文；trap帧在内核内存中，切换页表后仍可访问
+        frame = next->frame;
+        w_sepc(next->sepc);
+        w_sstatus((r_sstatus() & ~(SSTATUS_SPP | SSTATUS_SPIE)) | next->sstatus);
+        // S模式任务的tp是内核使用的hart ID，任务可能在其他hart上运行过
+        if (next->sstatus & SSTATUS_SPP) {
+            frame[REG_TP] = cpuid();
+        }
+        vm_switch(next->mm ? next->mm->pagetable : kernel_pagetable);
+        next->on_cpu = 1;
+
+        if (prev) {
+            prev->on_cpu = 0;
+            // 亲和性已不允许在本hart运行（sched_setaffinity）：交给允许的hart
+            if (prev->state == TASK_RUNNABLE && !((prev->cpus_allowed >> prev->cpu) & 1)) {
+                migrate_task(prev, select_allowed_cpu(prev));
+                resched_cpu(prev->cpu);
+            }
+            // 已退出的任务不再需要上下文，页表已不在使用中，可以释放
+            if (prev->state == TASK_ZOMBIE) {
+                task_exited(prev);
+            }
+        }
+
+        console_printf_SCHED("hart %d: 切换 pid %d -> pid %d\n",
+                             cpuid(), prev ? prev->pid : -1, next->pid);
+        c->cur = next;
+    }
+
+    next->state = TASK_RUNNING;
+    next->exec_start = now;
+    timer_reprogram();
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return frame;
+}
+
+// 调度器下一个需要时钟中断的时间点
+uint64 sched_next_event() {
+    uint64 when = ~0ULL;
+    struct task *cur = mycpu()->cur;
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        // 其他hart上的任务由所属hart负责唤醒，避免打扰隔离的hart
+        if (t->cpu != cpuid()) {
+            continue;
+        }
+        if (t->state == TASK_SLEEPING && t->wakeup_time < when) {
+            when = t->wakeup_time;
+        }
+        if (t->policy == SCHED_CLASS_EDF && t->edf.throttled &&
+            (t->state == TASK_RUNNABLE || t->state == TASK_RUNNING) &&
+            t->edf.next_release < when) {
+            when = t->edf.next_release;
+        }
+    }
+
+    // 正在运行的EDF任务在预算耗尽时需要被抢占
+    if (cur && cur->policy == SCHED_CLASS_EDF && !cur->edf.throttled) {
+        uint64 exhaust = cur->exec_start + cur->edf.remaining;
+        if (exhaust < when) {
+            when = exhaust;
+        }
+    }
+    return when;
+}
+
+// 当前任务让出CPU
+void sched_yield() {
+    struct task *t = current_task();
+    uint64 now = r_time();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    if (t->policy == SCHED_CLASS_EDF) {
+        // 本周期作业完成，睡眠到下一个周期释放
+        struct edf_entity *e = &t->edf;
+        e->job_done = 1;
+        e->nr_jobs++;
+        if (now > e->abs_deadline && !e->missed) {
+            e->missed = 1;
+            e->nr_misses++;
+            console_printf_SCHED("pid %d 错过截止时间 (超时 %lu us)\n",
+                                 t->pid, TICKS_TO_US(now - e->abs_deadline));
+        }
+        t->wakeup_time = e->next_release;
+        t->state = TASK_SLEEPING;
+    }
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 当前任务睡眠指定毫秒数
+void sched_sleep(uint64 milliseconds) {
+    struct task *t = current_task();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    t->wakeup_time = r_time() + US_TO_TICKS(milliseconds * 1000);
+    t->state = TASK_SLEEPING;
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+void sched_block(void *chan) {
+    struct task *t = current_task();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    t->wait_chan = chan;
+    t->wakeup_time = ~0ULL;
+    t->state = TASK_SLEEPING;
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+int sched_wakeup_chan(void *chan) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    int woken = 0;
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->state == TASK_SLEEPING && t->wait_chan == chan) {
+            t->wait_chan = NULL;
+            sched_wakeup_locked(t);
+            woken++;
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return woken;
+}
+
+// 当前任务退出
+void sched_exit(int code) {
+    struct task *t = current_task();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    if (t->policy == SCHED_CLASS_EDF) {
+        edf_total_bw -= t->edf.bw;
+        edf_exited_misses += t->edf.nr_misses;
+        console_printf_SCHED("EDF任务 pid %d 退出: 作业数=%lu, 错过截止时间=%lu\n",
+                             t->pid, t->edf.nr_jobs, t->edf.nr_misses);
+    }
+    t->state = TASK_ZOMBIE;
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 设置当前任务的EDF参数
+int sched_setattr(uint64 runtime_us, uint64 deadline_us, uint64 period_us) {
+    struct task *t = current_task();
+    uint64 old_bw = t->policy == SCHED_CLASS_EDF ? t->edf.bw : 0;
+    uint64 now = r_time();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+
+    // runtime为0：退出EDF调度类
+    if (runtime_us == 0) {
+        if (t->policy == SCHED_CLASS_EDF) {
+            uint64 min = fair_min_vruntime(t);
+            edf_total_bw -= old_bw;
+            edf_exited_misses += t->edf.nr_misses;
+            memset(&t->edf, 0, sizeof(t->edf));
+            t->policy = SCHED_CLASS_FAIR;
+            t->vruntime = min != ~0ULL ? min : 0;
+            mycpu()->need_resched = 1;
+        }
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return 0;
+    }
+
+    // 参数必须满足 runtime <= deadline <= period <= EDF_MAX_PERIOD_US
+    if (deadline_us == 0) {
+        deadline_us = period_us;
+    }
+    if (runtime_us > deadline_us || deadline_us > period_us || period_us > EDF_MAX_PERIOD_US) {
+        console_printf_SCHED("EDF参数无效: runtime=%lu, deadline=%lu, period=%lu\n",
+                             runtime_us, deadline_us, period_us);
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+
+    // 准入控制：总带宽不超过EDF_BW_LIMIT
+    uint64 bw = (runtime_us << BW_SHIFT) / period_us;
+    if (edf_total_bw - old_bw + bw > EDF_BW_LIMIT) {
+        console_printf_SCHED("EDF准入失败: 已用带宽=%lu, 申请带宽=%lu, 上限=%lu\n",
+                             edf_total_bw - old_bw, bw, (uint64)EDF_BW_LIMIT);
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+    edf_total_bw = edf_total_bw - old_bw + bw;
+
+    struct edf_entity *e = &t->edf;
+    e->runtime = US_TO_TICKS(runtime_us);
+    e->deadline = US_TO_TICKS(deadline_us);
+    e->period = US_TO_TICKS(period_us);
+    e->bw = bw;
+
+    // 第一个作业从现在开始
+    e->abs_deadline = now + e->deadline;
+    e->next_release = now + e->period;
+    e->remaining = e->runtime;
+    e->throttled = 0;
+    e->job_done = 0;
+    e->missed = 0;
+
+    // 更新exec_start，使之前的运行时间不计入预算
+    update_curr(t, now);
+    t->policy = SCHED_CLASS_EDF;
+    mycpu()->need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+
+    console_printf_SCHED("pid %d 进入EDF调度类: runtime=%lu us, deadline=%lu us, period=%lu us\n",
+                         t->pid, runtime_us, deadline_us, period_us);
+    return 0;
+}
+
+// 获取当前任务的调度统计
+void sched_getstat(struct sched_stat *st) {
+    struct task *t = current_task();
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    uint64 total = edf_exited_misses;
+
+    for (int i = 0; i < NTASK; i++) {
+        if (tasks[i].state != TASK_UNUSED && tasks[i].policy == SCHED_CLASS_EDF) {
+            total += tasks[i].edf.nr_misses;
+        }
+    }
+
+    st->policy = t->policy;
+    st->nr_jobs = t->edf.nr_jobs;
+    st->nr_misses = t->edf.nr_misses;
+    st->total_misses = total;
+    st->sum_exec_us = TICKS_TO_US(t->sum_exec + (r_time() - t->exec_start));
+    st->total_bw = (edf_total_bw * 1000) >> BW_SHIFT;
+    st->cpu = cpuid();
+    st->nr_migrations = t->nr_migrations;
+    st->fpu_saves = t->fpu_saves;
+    st->fpu_restores = t->fpu_restores;
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+// 按pid查找任务，0表示当前任务，调用者持有sched_lock
+static struct task *find_task_locked(int pid) {
+    if (pid == 0) {
+        return current_task();
+    }
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->pid == pid && t->state != TASK_UNUSED && t->state != TASK_NEW &&
+            t->state != TASK_ZOMBIE) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+int sched_setaffinity(int pid, uint64 mask) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    struct task *t = find_task_locked(pid);
+
+    // 空闲任务和kworker固定在各自的hart上
+    mask &= cpu_online_mask;
+    if (!t || mask == 0 || !t->mm) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+    t->cpus_allowed = mask;
+
+    // 所属hart不再允许：正在运行的任务先让它所在的hart切换出去，
+    // schedule会把它交给允许的hart；否则直接换到允许的hart
+    if (!((mask >> t->cpu) & 1)) {
+        if (t->on_cpu) {
+            resched_cpu(t->cpu);
+        } else {
+            migrate_task(t, select_allowed_cpu(t));
+            if (t->state == TASK_RUNNABLE) {
+                resched_cpu(t->cpu);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    console_printf_SCHED("pid %d 亲和性设置为 0x%lx\n", t->pid, mask);
+    return 0;
+}
+
+int sched_getaffinity(int pid, uint64 *mask) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    struct task *t = find_task_locked(pid);
+
+    if (!t) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+    *mask = t->cpus_allowed & cpu_online_mask;
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return 0;
+}
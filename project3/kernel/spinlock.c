@@ -0,0 +1,42 @@
+// spinlock.c - 多hart之间的自旋锁
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/spinlock.h"
+#include "../include/trap.h"
+#include "../include/util.h"
+
+void spin_init(struct spinlock *lk, const char *name) {
+    lk->locked = 0;
+    lk->name = name;
+    lk->cpu = -1;
+}
+
+uint64 spin_lock_irqsave(struct spinlock *lk) {
+    uint64 flags = irq_save();
+
+    if (spin_holding(lk)) {
+        panic("spin_lock: 重复获取锁");
+    }
+    // amoswap.w.aq：获取语义，临界区内的访存不会提前到加锁之前
+    while (__sync_lock_test_and_set(&lk->locked, 1) != 0)
+        ;
+    __sync_synchronize();
+    lk->cpu = cpuid();
+    return flags;
+}
+
+void spin_unlock_irqrestore(struct spinlock *lk, uint64 flags) {
+    if (!spin_holding(lk)) {
+        panic("spin_unlock: 未持有锁");
+    }
+    lk->cpu = -1;
+    // 释放语义：临界区内的访存在解锁前全部完成
+    __sync_synchronize();
+    __sync_lock_release(&lk->locked);
+    irq_restore(flags);
+}
+
+int spin_holding(struct spinlock *lk) {
+    return lk->locked && lk->cpu == cpuid();
+}
@@ -0,0 +1,86 @@
+// strace.c - 系统调用跟踪的每hart环形缓冲区
+//
+// 写入发生在系统调用返回路径上，只写本hart的缓冲区，锁几乎没有竞争；
+// 读取者逐个hart加锁取出。head和tail自由增长，使用时对长度取模。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/strace.h"
+#include "../include/uaccess.h"
+#include "../include/console.h"
+
+struct strace_ring {
+    struct spinlock lock;
+    uint64 head;            // 下一条记录写入的位置
+    uint64 tail;            // 下一条要读出的记录
+    uint64 lost;            // 未读出就被覆盖的记录数
+    struct strace_rec recs[STRACE_RING_SIZE];
+};
+
+static struct strace_ring strace_rings[NCPU] = {
+    [0 ... NCPU - 1] = { .lock = SPINLOCK_INIT("strace") },
+};
+
+int strace_ctl(int pid, int on) {
+    uint64 flags = spin_lock_irqsave(&sched_lock);
+    int tgid = pid ? pid : current_task()->tgid;
+    int found = 0;
+
+    for (int i = 0; i < NTASK; i++) {
+        struct task *t = &tasks[i];
+        if (t->state != TASK_UNUSED && t->mm && t->tgid == tgid) {
+            t->traced = on ? 1 : 0;
+            found = 1;
+        }
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return found ? 0 : -1;
+}
+
+void strace_record(uint64 num, const uint64 *args, uint64 ret, uint64 enter, uint64 exit) {
+    struct strace_ring *r = &strace_rings[cpuid()];
+    uint64 flags = spin_lock_irqsave(&r->lock);
+
+    if (r->head - r->tail == STRACE_RING_SIZE) {
+        r->tail++;
+        r->lost++;
+    }
+    struct strace_rec *rec = &r->recs[r->head % STRACE_RING_SIZE];
+    rec->enter = enter;
+    rec->exit = exit;
+    rec->pid = current_task()->pid;
+    rec->num = num;
+    rec->cpu = cpuid();
+    for (int i = 0; i < 6; i++) {
+        rec->args[i] = args[i];
+    }
+    rec->ret = ret;
+    r->head++;
+    spin_unlock_irqrestore(&r->lock, flags);
+}
+
+int strace_read(uint64 ubuf, int max, uint64 *lost) {
+    int n = 0;
+
+    *lost = 0;
+    for (int h = 0; h < NCPU && n < max; h++) {
+        struct strace_ring *r = &strace_rings[h];
+        uint64 flags = spin_lock_irqsave(&r->lock);
+
+        *lost += r->lost;
+        r->lost = 0;
+        while (r->tail != r->head && n < max) {
+            struct strace_rec rec = r->recs[r->tail % STRACE_RING_SIZE];
+            if (copy_to_user(ubuf + n * sizeof(rec), &rec, sizeof(rec)) < 0) {
+                spin_unlock_irqrestore(&r->lock, flags);
+                return n ? n : -1;
+            }
+            r->tail++;
+            n++;
+        }
+        spin_unlock_irqrestore(&r->lock, flags);
+    }
+    return n;
+}
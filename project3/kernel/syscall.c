@@ -2,36 +2,39 @@
 #include "../include/console.h"
 #include "../include/types.h"
 #include "../include/timer.h"
-
-// 前向声明
-uint64 sys_yield();
+#include "../include/sched.h"
+#include "../include/proc.h"
+#include "../include/exec.h"
+#include "../include/vm.h"
+#include "../include/riscv.h"
+#include "../include/util.h"
+#include "../include/file.h"
+#include "../include/spawn.h"
+#include "../include/futex.h"
+#include "../include/ring.h"
+#include "../include/strace.h"
+#include "../include/uaccess.h"
+#include "../include/irqstat.h"
 
 // 系统调用：写入
 uint64 sys_write(int fd, const char *buf, uint64 count) {
     console_printf_SYSCALL("sys_write: fd=%d, buf=0x%lx, count=%lu\n", fd, (uint64)buf, count);
     
-    // 目前只支持标准输出（fd=1）
-    if (fd != 1) return -1;
-    
-    // 安全检查：确保buf指向有效内存
-    // 在实际系统中，需要检查buf是否在用户空间范围内
-    
-    // 输出字符
-    for (uint64 i = 0; i < count; i++) {
-        console_putc(buf[i]);
-    }
+    struct file *f = fd_get(fd);
+    if (f == NULL) return -1;
     
-    return count;
+    // buf由copy_from_user检查范围，访问出错时返回-1
+    return filewrite(f, buf, count, 0);
 }
 
 // 系统调用：退出
 uint64 sys_exit(int code) {
     console_printf_SYSCALL("sys_exit: code=%d\n", code);
     
-    // 在实际系统中，这里应该终止当前进程
     console_printf_SYSCALL("进程退出，退出码: %d\n", code);
     
-    // 目前我们没有进程管理，所以只是返回
+    // 进程的所有线程一起退出，主线程通知父进程，trap返回前切换到其他任务
+    task_exit_group(code);
     return 0;
 }
 
@@ -39,23 +42,23 @@ uint64 sys_exit(int code) {
 uint64 sys_getpid() {
     console_printf_SYSCALL("sys_getpid\n");
     
-    // 在实际系统中，这里应该返回当前进程ID
-    // 目前我们没有进程管理，所以返回一个固定值
-    return 1;
+    // 同一进程的所有线程返回相同的进程ID
+    return current_task()->tgid;
+}
+
+// 系统调用：获取线程ID
+uint64 sys_gettid() {
+    console_printf_SYSCALL("sys_gettid\n");
+    
+    return current_task()->pid;
 }
 
 // 系统调用：睡眠
 uint64 sys_sleep(uint64 milliseconds) {
     console_printf_SYSCALL("sys_sleep: milliseconds=%lu\n", milliseconds);
     
-    uint64 start_time = get_time_ms();
-    uint64 end_time = start_time + milliseconds;
-    
-    while (get_time_ms() < end_time) {
-        // 在实际系统中，这里应该让当前进程进入睡眠状态
-        // 目前我们没有进程管理，所以只是忙等待
-        sys_yield(); // 让出CPU
-    }
+    // 当前任务进入睡眠状态，由时钟中断在到期时唤醒
+    sched_sleep(milliseconds);
     
     return 0;
 }
@@ -64,8 +67,8 @@ uint64 sys_sleep(uint64 milliseconds) {
 uint64 sys_yield() {
     console_printf_SYSCALL("sys_yield\n");
     
-    // 在实际系统中，这里应该触发调度器选择下一个进程运行
-    // 目前我们没有进程管理，所以只是返回
+    // 触发调度器选择下一个任务运行；EDF任务表示本周期作业完成
+    sched_yield();
     return 0;
 }
 
@@ -77,135 +80,369 @@ uint64 sys_time() {
 }
 
 // 系统调用：执行程序
-uint64 sys_exec(const char *path, char *const argv[]) {
-    console_printf_SYSCALL("sys_exec: path=%s\n", path);
+uint64 sys_exec(const char *path, char *const argv[], char *const envp[]) {
+    struct task *t = current_task();
+    struct mm *old = t->mm;
+    char kpath[MAXPATH];
     
-    // 在实际系统中，这里应该加载并执行指定的程序
-    console_printf_SYSCALL("执行程序: %s\n", path);
+    // 日志中的%s在记录时被读取，只能使用复制到内核中的路径
+    if (strncpy_from_user(kpath, (uint64)path, sizeof(kpath)) < 0) {
+        console_printf_SYSCALL("sys_exec: path=0x%lx 无效\n", (uint64)path);
+        return -1;
+    }
+    console_printf_SYSCALL("sys_exec: path=%s\n", kpath);
     
-    // 目前我们没有文件系统和进程管理，所以只是返回错误
-    return -1;
+    // 从initramfs加载ELF程序，参数在旧地址空间中，加载完成前旧页表保持有效
+    int argc = exec_load(t, kpath, argv, envp, 1);
+    if (argc < 0) {
+        return -1;
+    }
+    console_printf_SYSCALL("执行程序: %s\n", kpath);
+    // 其他线程还在旧地址空间中运行，让它们退出
+    task_kill_threads();
+    
+    // exec_load已把新程序的上下文写入当前trap帧（t->tf），返回值argc放入a0
+    w_sepc(t->sepc);
+    vm_switch(t->mm->pagetable);
+    if (old) {
+        mm_put(old);
+    }
+    return argc;
 }
 
 // 系统调用：创建子进程
 uint64 sys_fork() {
     console_printf_SYSCALL("sys_fork\n");
     
-    // 在实际系统中，这里应该创建当前进程的副本
-    console_printf_SYSCALL("创建子进程\n");
-    
-    // 目前我们没有进程管理，所以只是返回错误
-    return -1;
+    // 复制当前进程的地址空间和文件描述符，子进程返回0
+    return task_fork();
 }
 
 // 系统调用：等待子进程
 uint64 sys_wait(int *status) {
     console_printf_SYSCALL("sys_wait: status=0x%lx\n", (uint64)status);
     
-    // 在实际系统中，这里应该等待任意子进程终止
-    console_printf_SYSCALL("等待子进程\n");
-    
-    // 目前我们没有进程管理，所以只是返回错误
-    return -1;
+    // 等待任意子进程终止，返回其pid；没有子进程返回-1
+    return task_wait((uint64)status);
 }
 
 // 系统调用：打开文件
 uint64 sys_open(const char *path, int flags) {
-    console_printf_SYSCALL("sys_open: path=%s, flags=%d\n", path, flags);
+    char kpath[MAXPATH];
+    if (strncpy_from_user(kpath, (uint64)path, sizeof(kpath)) < 0) {
+        console_printf_SYSCALL("sys_open: path=0x%lx 无效\n", (uint64)path);
+        return -1;
+    }
+    console_printf_SYSCALL("sys_open: path=%s, flags=%d\n", kpath, flags);
     
-    // 在实际系统中，这里应该打开指定的文件
-    console_printf_SYSCALL("打开文件: %s\n", path);
+    // 目前只能只读打开initramfs中的文件
+    struct file *f = file_open(kpath, flags);
+    if (f == NULL) return -1;
     
-    // 目前我们没有文件系统，所以只是返回错误
-    return -1;
+    int fd = fd_install(current_task(), f);
+    if (fd < 0) {
+        fileclose(f);
+    }
+    return fd;
 }
 
 // 系统调用：关闭文件
 uint64 sys_close(int fd) {
     console_printf_SYSCALL("sys_close: fd=%d\n", fd);
     
-    // 在实际系统中，这里应该关闭指定的文件描述符
-    console_printf_SYSCALL("关闭文件描述符: %d\n", fd);
-    
-    // 目前我们没有文件系统，所以只是返回错误
-    return -1;
+    return fd_close(current_task(), fd);
 }
 
 // 系统调用：读取文件
 uint64 sys_read(int fd, void *buf, uint64 count) {
     console_printf_SYSCALL("sys_read: fd=%d, buf=0x%lx, count=%lu\n", fd, (uint64)buf, count);
     
-    // 在实际系统中，这里应该从指定的文件描述符读取数据
-    // 目前只支持标准输入（fd=0）
-    if (fd != 0) return -1;
+    struct file *f = fd_get(fd);
+    if (f == NULL) return -1;
+    
+    // buf由copy_to_user检查范围，访问出错时返回-1；控制台没有输入时阻塞
+    return fileread(f, buf, count, 0);
+}
+
+// 系统调用：复制文件描述符
+uint64 sys_dup2(int oldfd, int newfd) {
+    console_printf_SYSCALL("sys_dup2: oldfd=%d, newfd=%d\n", oldfd, newfd);
     
-    // 安全检查：确保buf指向有效内存
-    // 在实际系统中，需要检查buf是否在用户空间范围内
+    return fd_dup2(current_task(), oldfd, newfd);
+}
+
+// 系统调用：直接从程序文件创建子进程，不经过fork复制地址空间
+uint64 sys_spawn(const char *path, char *const argv[], const struct spawn_file_actions *fa) {
+    char kpath[MAXPATH];
+    if (strncpy_from_user(kpath, (uint64)path, sizeof(kpath)) < 0) {
+        console_printf_SYSCALL("sys_spawn: path=0x%lx 无效\n", (uint64)path);
+        return -1;
+    }
+    console_printf_SYSCALL("sys_spawn: path=%s\n", kpath);
+    
+    return task_spawn(kpath, argv, NULL, fa);
+}
+
+// 系统调用：创建线程，与当前进程共享地址空间，从fn(arg)开始运行
+uint64 sys_clone(uint64 fn, uint64 arg, uint64 stack, uint64 tls, uint64 ctid) {
+    console_printf_SYSCALL("sys_clone: fn=0x%lx, stack=0x%lx, tls=0x%lx\n", fn, stack, tls);
     
-    // 目前我们没有实现控制台输入，所以只是返回0（表示EOF）
+    return task_clone(fn, arg, stack, tls, ctid);
+}
+
+// 系统调用：只退出当前线程
+uint64 sys_thread_exit(int code) {
+    console_printf_SYSCALL("sys_thread_exit: code=%d\n", code);
+    
+    task_exit(code);
     return 0;
 }
 
+// 系统调用：调整堆顶，返回原来的堆顶
+uint64 sys_sbrk(int64 n) {
+    console_printf_SYSCALL("sys_sbrk: n=%ld\n", n);
+    
+    struct task *t = current_task();
+    if (!t->mm) return -1;
+    
+    return mm_sbrk(t->mm, n);
+}
+
+// 系统调用：在用户地址上等待或唤醒
+uint64 sys_futex(uint64 uaddr, int op, uint64 val) {
+    console_printf_SYSCALL("sys_futex: uaddr=0x%lx, op=%d, val=%lu\n", uaddr, op, val);
+    
+    switch (op) {
+        case FUTEX_WAIT:
+            return futex_wait(uaddr, (uint32)val);
+        case FUTEX_WAKE:
+            return futex_wake(uaddr, (int)val);
+        default:
+            return -1;
+    }
+}
+
+// 系统调用：设置任务允许运行的hart掩码
+uint64 sys_sched_setaffinity(int pid, uint64 mask) {
+    console_printf_SYSCALL("sys_sched_setaffinity: pid=%d, mask=0x%lx\n", pid, mask);
+    
+    return sched_setaffinity(pid, mask);
+}
+
+// 系统调用：获取任务允许运行的hart掩码
+uint64 sys_sched_getaffinity(int pid, uint64 *umask) {
+    console_printf_SYSCALL("sys_sched_getaffinity: pid=%d\n", pid);
+    
+    uint64 mask;
+    if (sched_getaffinity(pid, &mask) < 0) return -1;
+    
+    return copy_to_user((uint64)umask, &mask, sizeof(mask));
+}
+
+// 系统调用：设置EDF调度参数（微秒）
+uint64 sys_sched_setattr(uint64 runtime, uint64 deadline, uint64 period) {
+    console_printf_SYSCALL("sys_sched_setattr: runtime=%lu, deadline=%lu, period=%lu\n",
+                           runtime, deadline, period);
+    
+    return sched_setattr(runtime, deadline, period);
+}
+
+// 系统调用：获取调度统计（包括EDF错过截止时间计数）
+uint64 sys_sched_getstat(struct sched_stat *st) {
+    console_printf_SYSCALL("sys_sched_getstat: st=0x%lx\n", (uint64)st);
+    
+    struct sched_stat kst;
+    sched_getstat(&kst);
+    return copy_to_user((uint64)st, &kst, sizeof(kst));
+}
+
+// 系统调用：建立提交/完成队列共享页
+uint64 sys_ring_setup() {
+    console_printf_SYSCALL("sys_ring_setup\n");
+    
+    return ring_setup();
+}
+
+// 系统调用：处理提交队列中的操作
+uint64 sys_ring_enter(uint64 to_submit) {
+    console_printf_SYSCALL("sys_ring_enter: to_submit=%lu\n", to_submit);
+    
+    return ring_enter((uint32)to_submit);
+}
+
+// 系统调用：打开或关闭进程的系统调用跟踪
+uint64 sys_strace_ctl(int pid, int on) {
+    console_printf_SYSCALL("sys_strace_ctl: pid=%d, on=%d\n", pid, on);
+    
+    return strace_ctl(pid, on);
+}
+
+// 系统调用：取出跟踪记录，被覆盖的记录数写入*ulost
+uint64 sys_strace_read(struct strace_rec *ubuf, int max, uint64 *ulost) {
+    console_printf_SYSCALL("sys_strace_read: buf=0x%lx, max=%d\n", (uint64)ubuf, max);
+    
+    uint64 lost;
+    int n = strace_read((uint64)ubuf, max, &lost);
+    if (ulost && copy_to_user((uint64)ulost, &lost, sizeof(lost)) < 0) {
+        return -1;
+    }
+    return n;
+}
+
+// 系统调用：获取一个系统调用的调用次数和延迟直方图
+static struct syscall_stat syscall_stats[NSYSCALL];
+
+uint64 sys_syscall_stat(int num, struct syscall_stat *ust) {
+    console_printf_SYSCALL("sys_syscall_stat: num=%d\n", num);
+    
+    if (num <= 0 || num >= NSYSCALL) return -1;
+    
+    struct syscall_stat st = syscall_stats[num];
+    return copy_to_user((uint64)ust, &st, sizeof(st));
+}
+
+// 系统调用：取hart的一种中断源的延迟统计；ust为NULL时在控制台输出所有统计
+uint64 sys_irq_stat(int hart, int src, struct irq_stat *ust) {
+    console_printf_SYSCALL("sys_irq_stat: hart=%d, src=%d\n", hart, src);
+    
+    if (ust == NULL) {
+        irq_stat_print();
+        return 0;
+    }
+    
+    struct irq_stat st;
+    if (irq_stat_get(hart, src, &st) < 0) return -1;
+    
+    return copy_to_user((uint64)ust, &st, sizeof(st));
+}
+
+// 系统调用：设置控制台输入模式（CONSOLE_CANON/CONSOLE_RAW），负数只查询；返回原来的模式
+uint64 sys_console_mode(int mode) {
+    console_printf_SYSCALL("sys_console_mode: mode=%d\n", mode);
+    
+    return console_set_mode(mode);
+}
+
+// 系统调用：设置日志模块的级别（LOG_OFF/LOG_INFO/LOG_DEBUG），负数只查询；返回原来的级别
+// name为NULL时在控制台输出所有模块的级别
+uint64 sys_log_level(const char *uname, int level) {
+    console_printf_SYSCALL("sys_log_level: name=0x%lx, level=%d\n", (uint64)uname, level);
+    
+    if (uname == NULL) {
+        console_print_log_levels();
+        return 0;
+    }
+    
+    // 名字放不下时返回-1，截断后可能误匹配其他模块
+    char name[16];
+    if (strncpy_from_user(name, (uint64)uname, sizeof(name)) < 0) {
+        return -1;
+    }
+    
+    return console_set_log_level(name, level);
+}
+
+// 分发表的处理函数：把寄存器中的参数转换为各系统调用的参数类型
+typedef uint64 (*syscall_fn)(uint64 a0, uint64 a1, uint64 a2, uint64 a3, uint64 a4, uint64 a5);
+
+#define SYSCALL_ADAPTER(name, call) \
+    static uint64 do_##name(uint64 a0, uint64 a1, uint64 a2, uint64 a3, uint64 a4, uint64 a5) { \
+        return call; \
+    }
+
+SYSCALL_ADAPTER(write, sys_write((int)a0, (const char*)a1, a2))
+SYSCALL_ADAPTER(exit, sys_exit((int)a0))
+SYSCALL_ADAPTER(getpid, sys_getpid())
+SYSCALL_ADAPTER(sleep, sys_sleep(a0))
+SYSCALL_ADAPTER(yield, sys_yield())
+SYSCALL_ADAPTER(time, sys_time())
+SYSCALL_ADAPTER(exec, sys_exec((const char*)a0, (char *const*)a1, (char *const*)a2))
+SYSCALL_ADAPTER(fork, sys_fork())
+SYSCALL_ADAPTER(wait, sys_wait((int*)a0))
+SYSCALL_ADAPTER(open, sys_open((const char*)a0, (int)a1))
+SYSCALL_ADAPTER(close, sys_close((int)a0))
+SYSCALL_ADAPTER(read, sys_read((int)a0, (void*)a1, a2))
+SYSCALL_ADAPTER(sched_setattr, sys_sched_setattr(a0, a1, a2))
+SYSCALL_ADAPTER(sched_getstat, sys_sched_getstat((struct sched_stat*)a0))
+SYSCALL_ADAPTER(spawn, sys_spawn((const char*)a0, (char *const*)a1, (const struct spawn_file_actions*)a2))
+SYSCALL_ADAPTER(dup2, sys_dup2((int)a0, (int)a1))
+SYSCALL_ADAPTER(clone, sys_clone(a0, a1, a2, a3, a4))
+SYSCALL_ADAPTER(thread_exit, sys_thread_exit((int)a0))
+SYSCALL_ADAPTER(gettid, sys_gettid())
+SYSCALL_ADAPTER(sbrk, sys_sbrk((int64)a0))
+SYSCALL_ADAPTER(futex, sys_futex(a0, (int)a1, a2))
+SYSCALL_ADAPTER(sched_setaffinity, sys_sched_setaffinity((int)a0, a1))
+SYSCALL_ADAPTER(sched_getaffinity, sys_sched_getaffinity((int)a0, (uint64*)a1))
+SYSCALL_ADAPTER(syscall_stat, sys_syscall_stat((int)a0, (struct syscall_stat*)a1))
+SYSCALL_ADAPTER(ring_setup, sys_ring_setup())
+SYSCALL_ADAPTER(ring_enter, sys_ring_enter(a0))
+SYSCALL_ADAPTER(strace_ctl, sys_strace_ctl((int)a0, (int)a1))
+SYSCALL_ADAPTER(strace_read, sys_strace_read((struct strace_rec*)a0, (int)a1, (uint64*)a2))
+SYSCALL_ADAPTER(irq_stat, sys_irq_stat((int)a0, (int)a1, (struct irq_stat*)a2))
+SYSCALL_ADAPTER(console_mode, sys_console_mode((int)a0))
+SYSCALL_ADAPTER(log_level, sys_log_level((const char*)a0, (int)a1))
+
+// 分发表，按系统调用号索引，由syscall_list.h生成；缺少处理函数时编译失败
+static const struct {
+    const char *name;
+    syscall_fn fn;
+} syscall_table[NSYSCALL] = {
+#define SYSCALL(num, sys) [num] = { .name = #sys, .fn = do_##sys },
+#include "../include/syscall_list.h"
+#undef SYSCALL
+};
+
+void syscall_restart() {
+    current_task()->restart_syscall = 1;
+}
+
+// 直方图桶号：floor(log2(cycles))，超出范围的放入最后一个桶
+static int hist_bucket(uint64 cycles) {
+    int b = 0;
+    while (cycles > 1 && b < SYSCALL_HIST_BUCKETS - 1) {
+        cycles >>= 1;
+        b++;
+    }
+    return b;
+}
+
 // 系统调用处理函数
+// 耗时只包括处理函数本身，阻塞的系统调用在返回之后才切换任务，不计入等待时间
 uint64 syscall(uint64 syscall_num, uint64 a0, uint64 a1, uint64 a2, uint64 a3, uint64 a4, uint64 a5) {
-    console_printf_SYSCALL("处理系统调用，系统调用号: %ld (0x%lx)\n", syscall_num, syscall_num);
-    
-    uint64 ret = -1;
-    
-    switch (syscall_num) {
-        case SYS_write:
-            console_printf_SYSCALL("执行write系统调用\n");
-            ret = sys_write((int)a0, (const char*)a1, a2);
-            break;
-        case SYS_exit:
-            console_printf_SYSCALL("执行exit系统调用\n");
-            ret = sys_exit((int)a0);
-            break;
-        case SYS_getpid:
-            console_printf_SYSCALL("执行getpid系统调用\n");
-            ret = sys_getpid();
-            break;
-        case SYS_sleep:
-            console_printf_SYSCALL("执行sleep系统调用\n");
-            ret = sys_sleep(a0);
-            break;
-        case SYS_yield:
-            console_printf_SYSCALL("执行yield系统调用\n");
-            ret = sys_yield();
-            break;
-        case SYS_time:
-            console_printf_SYSCALL("执行time系统调用\n");
-            ret = sys_time();
-            break;
-        case SYS_exec:
-            console_printf_SYSCALL("执行exec系统调用\n");
-            ret = sys_exec((const char*)a0, (char *const*)a1);
-            break;
-        case SYS_fork:
-            console_printf_SYSCALL("执行fork系统调用\n");
-            ret = sys_fork();
-            break;
-        case SYS_wait:
-            console_printf_SYSCALL("执行wait系统调用\n");
-            ret = sys_wait((int*)a0);
-            break;
-        case SYS_open:
-            console_printf_SYSCALL("执行open系统调用\n");
-            ret = sys_open((const char*)a0, (int)a1);
-            break;
-        case SYS_close:
-            console_printf_SYSCALL("执行close系统调用\n");
-            ret = sys_close((int)a0);
-            break;
-        case SYS_read:
-            console_printf_SYSCALL("执行read系统调用\n");
-            ret = sys_read((int)a0, (void*)a1, a2);
-            break;
-        default:
-            console_printf_SYSCALL("未知系统调用: %ld\n", syscall_num);
-            break;
+    // 编号表中的空缺在分发表中是空项，与越界的编号一样处理
+    if (syscall_num >= NSYSCALL || syscall_table[syscall_num].fn == NULL) {
+        console_printf_SYSCALL("未知系统调用: %ld\n", syscall_num);
+        return -1;
     }
     
-    console_printf_SYSCALL("系统调用返回值: 0x%lx\n", ret);
+    // 读取跟踪记录本身不记录，否则每次读取都会产生新的记录
+    int traced = current_task()->traced && syscall_num != SYS_strace_read;
+    uint64 enter = traced ? r_time() : 0;
+    
+    uint64 start = r_cycle();
+    uint64 ret = syscall_table[syscall_num].fn(a0, a1, a2, a3, a4, a5);
+    uint64 cycles = r_cycle() - start;
+    
+    // 调用者在进入处理函数之前已经把sepc加4，退回后唤醒时重新执行ecall
+    struct task *t = current_task();
+    if (t->restart_syscall) {
+        t->restart_syscall = 0;
+        w_sepc(r_sepc() - 4);
+        ret = a0;
+    }
+    
+    if (traced) {
+        uint64 args[6] = { a0, a1, a2, a3, a4, a5 };
+        strace_record(syscall_num, args, ret, enter, r_time());
+    }
+    
+    // 多个hart同时更新，使用原子操作
+    struct syscall_stat *st = &syscall_stats[syscall_num];
+    __sync_fetch_and_add(&st->count, 1);
+    __sync_fetch_and_add(&st->cycles, cycles);
+    __sync_fetch_and_add(&st->hist[hist_bucket(cycles)], 1);
+    
+    console_debug_SYSCALL("%s(0x%lx, 0x%lx, 0x%lx) = 0x%lx, %lu cycles\n",
+                           syscall_table[syscall_num].name, a0, a1, a2, ret, cycles);
     return ret;
-}
\ No newline at end of file
+}
@@ -4,23 +4,105 @@
 #include "../include/riscv.h"
 #include "../include/timer.h"
 #include "../include/console.h"
+#include "../include/sched.h"
+#include "../include/proc.h"
+#include "../include/trap.h"
+#include "../include/workqueue.h"
+#include "../include/ipi.h"
+#include "../include/vdso.h"
+#include "../include/irqstat.h"
+#include "../include/uart.h"
+#include "../include/plic.h"
+#include "../include/klog.h"
 
-// QEMU RISC-V的CLINT (Core Local Interruptor)地址
-#define CLINT_BASE      0x2000000
-#define CLINT_MTIME     (CLINT_BASE + 0xBFF8)  // 计时器寄存器
-#define CLINT_MTIMECMP  (CLINT_BASE + 0x4000)  // 计时器比较寄存器
+// 每次时钟中断的时间间隔（timebase tick）
+#define TIMER_INTERVAL  (CLOCK_FREQ / TIMER_HZ)  // 10ms
 
-// 时钟频率 (QEMU默认为10MHz)
-#define CLOCK_FREQ      10000000
+// 系统启动以来的时钟中断计数
+static uint64 ticks = 0;
 
-// 每次时钟中断的时间间隔（纳秒）
-#define TIMER_INTERVAL_NS 10000000  // 10ms
+// 每个hart下一次周期时钟中断的时间
+static uint64 next_tick[NCPU];
 
-// 系统启动以来的毫秒计数
-static uint64 ticks = 0;
+// 每个hart上次写入stimecmp的值，时钟中断到达时用来计算延迟（irqstat.c）
+static uint64 armed[NCPU];
+
+// 软中断中已报告到的秒数
+static uint64 reported_secs = 0;
+
+// 上次报告时各hart的统计值，用于计算每秒的变化
+static uint64 last_report_time;
+static uint64 last_busy[NCPU];
+static uint64 last_migrations[NCPU];
+static uint64 last_ipis[NCPU];
+static uint64 last_uart_bytes, last_uart_busy, last_uart_irqs;
+
+// 输出上次报告以来各hart的利用率、迁入任务数、收到的核间中断数，以及各hart的最长关中断时间
+static void report_cpu_stats(void) {
+    uint64 now = r_time();
+    uint64 elapsed = now - last_report_time;
+
+    last_report_time = now;
+
+    // 串口吞吐量和控制台输出占用的CPU时间（所有hart合计）
+    uint64 bytes, busy, irqs = plic_irq_count(UART0_IRQ);
+    uart_stat(&bytes, &busy);
+    console_printf("串口: 发送 %lu 字节/秒, 中断 %lu 次/秒, 输出占用CPU %lu us/秒\n",
+                   elapsed ? (bytes - last_uart_bytes) * CLOCK_FREQ / elapsed : 0,
+                   elapsed ? (irqs - last_uart_irqs) * CLOCK_FREQ / elapsed : 0,
+                   elapsed ? TICKS_TO_US((busy - last_uart_busy) * CLOCK_FREQ / elapsed) : 0);
+    last_uart_bytes = bytes;
+    last_uart_busy = busy;
+    last_uart_irqs = irqs;
+
+    for (int i = 0; i < NCPU; i++) {
+        if (!((cpu_online_mask >> i) & 1)) {
+            continue;
+        }
+        struct cpu *c = &cpus[i];
+        uint64 busy = c->busy_time, migrations = c->nr_migrations, ipis = ipi_count(i);
+        console_printf("hart %d: 利用率 %lu%%, 迁入 %lu 次/秒, 核间中断 %lu 次/秒%s\n", i,
+                       elapsed ? (busy - last_busy[i]) * 100 / elapsed : 0,
+                       elapsed ? (migrations - last_migrations[i]) * CLOCK_FREQ / elapsed : 0,
+                       elapsed ? (ipis - last_ipis[i]) * CLOCK_FREQ / elapsed : 0,
+                       cpu_isolated(i) ? " (隔离)" : "");
+        struct irq_stat st;
+        irq_stat_get(i, IRQ_SRC_TIMER, &st);
+        if (st.count) {
+            console_printf("hart %d: 时钟中断延迟 平均 %lu ns, 最大 %lu ns\n", i,
+                           st.entry_sum * 1000 / st.count / (CLOCK_FREQ / 1000000),
+                           st.entry_max * 1000 / (CLOCK_FREQ / 1000000));
+        }
+        const char *where;
+        uint64 irqoff = irqoff_max(i, &where);
+        console_printf("hart %d: 最长关中断时间 %lu us (%s)\n", i, TICKS_TO_US(irqoff), where);
+        last_busy[i] = busy;
+        last_migrations[i] = migrations;
+        last_ipis[i] = ipis;
+    }
+}
+
+// 时钟中断下半部：在kworker中输出每秒的时钟信息和各hart的负载、最长关中断时间
+static void timer_softirq(void) {
+    uint64 secs = ticks / TIMER_HZ;
+
+    if (reported_secs >= secs) {
+        return;
+    }
+    while (reported_secs < secs) {
+        reported_secs++;
+        console_printf("时钟中断: %lu 秒\n", reported_secs);
+    }
+    report_cpu_stats();
+}
 
 // 初始化时钟
+// 每个hart都有自己的stimecmp，各自调用一次
 void timer_init() {
+    if (cpuid() == 0) {
+        open_softirq(SOFTIRQ_TIMER, timer_softirq);
+    }
+    next_tick[cpuid()] = r_time();
     // 设置第一次时钟中断
     timer_set_next();
     console_printf("时钟初始化完成\n");
@@ -28,35 +110,74 @@ void timer_init() {
 
 // 设置下一次时钟中断
 void timer_set_next() {
-    // 读取当前时间
-    uint64 *mtime_ptr = (uint64*)CLINT_MTIME;
-    uint64 mtime = *mtime_ptr;
-    
-    // 设置下一次中断时间
-    uint64 *mtimecmp_ptr = (uint64*)CLINT_MTIMECMP;
-    *mtimecmp_ptr = mtime + TIMER_INTERVAL_NS;
+    uint64 now = r_time();
+    uint64 *next = &next_tick[cpuid()];
+
+    // 按固定间隔推进，落后太多时直接从当前时间重新开始
+    *next += TIMER_INTERVAL;
+    if (*next <= now) {
+        *next = now + TIMER_INTERVAL;
+    }
+    timer_reprogram();
+}
+
+// stimecmp取周期tick和调度器事件（EDF预算耗尽、周期释放、睡眠唤醒）中较早者
+// 隔离的hart上只有一个任务可运行时不需要时间片轮转，关闭周期tick，
+// 只保留该任务自己的调度事件；空闲时保留tick以发现其他hart唤醒的任务
+void timer_reprogram() {
+    uint64 when = next_tick[cpuid()];
+    uint64 event = sched_next_event();
+
+    if (cpu_isolated(cpuid()) && mycpu()->nr_running == 1) {
+        when = ~0ULL;
+    }
+
+    if (event < when) {
+        when = event;
+    }
+    armed[cpuid()] = when;
+    w_stimecmp(when);
 }
 
 // 获取当前时间（毫秒）
 uint64 get_time_ms() {
-    uint64 *mtime_ptr = (uint64*)CLINT_MTIME;
-    uint64 mtime = *mtime_ptr;
-    
-    // 转换为毫秒
-    return (mtime * 1000) / CLOCK_FREQ;
+    // 转换为毫秒，从内核启动时刻（vDSO时间页的零点）开始计算
+    return ((r_time() - vdso_clock_offset()) * 1000) / CLOCK_FREQ;
 }
 
 // 处理时钟中断
 void timer_handler() {
-    ticks++;
-    
-    // 设置下一次时钟中断
-    timer_set_next();
-    
-    // 每秒打印一次（每100个tick）
-    if (ticks % 100 == 0) {
-        console_printf("时钟中断: %d 秒\n", ticks / 100);
-    }
-    
-    // 在实际系统中，这里应该触发调度器进行进程切换
-}
\ No newline at end of file
+    uint64 now = r_time();
+    // 先取出到期时间，下面重新设置stimecmp时armed会被改写
+    uint64 deadline = armed[cpuid()];
+    int expired = now >= deadline;
+
+    if (expired) {
+        irq_latency_entry(IRQ_SRC_TIMER, deadline);
+    }
+
+    // 调度器事件也会触发时钟中断，只有到达周期时间时才计tick
+    // 全局tick计数只由hart 0推进
+    if (now >= next_tick[cpuid()]) {
+        if (cpuid() == 0) {
+            ticks++;
+
+            // 每秒打印一次，输出交给下半部
+            if (ticks % TIMER_HZ == 0) {
+                raise_softirq(SOFTIRQ_TIMER);
+            }
+            // 各hart的日志缓冲区由hart 0的kworker统一输出
+            klog_tick();
+        }
+
+        timer_set_next();
+    }
+
+    // 唤醒到期任务、补充EDF预算，并请求重新调度
+    sched_tick(now);
+    timer_reprogram();
+
+    if (expired) {
+        irq_latency_exit(IRQ_SRC_TIMER, deadline);
+    }
+}
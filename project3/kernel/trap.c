@@ -3,9 +3,132 @@
 #include "../include/console.h"
 #include "../include/syscall.h"
 #include "../include/timer.h"
+#include "../include/trap.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/klog.h"
+#include "../include/ipi.h"
+#include "../include/fpu.h"
+#include "../include/uaccess.h"
+#include "../include/irqstat.h"
+#include "../include/plic.h"
 
-// 声明外部汇编函数trap_vector
+// 默认使用向量模式，Makefile中TRAP_VECTORED=0时回到直接模式
+#ifndef TRAP_VECTORED
+#define TRAP_VECTORED 1
+#endif
+
+// 声明外部汇编函数trap_vector和向量模式的入口表
 extern void trap_vector();
+extern void trap_vector_table();
+
+// 每个hart的关中断时间统计
+struct irqoff_stat {
+    uint64 start;           // irq_save临界区的开始时间
+    uint64 max;             // 最长关中断时间
+    const char *where;      // 最长关中断发生的位置
+};
+
+static struct irqoff_stat irqoff_stats[NCPU];
+
+// 记录一次关中断区间
+static void irqoff_account(uint64 start, const char *where) {
+    struct irqoff_stat *st = &irqoff_stats[cpuid()];
+    uint64 duration = r_time() - start;
+
+    if (duration > st->max) {
+        st->max = duration;
+        st->where = where;
+    }
+}
+
+uint64 irq_save() {
+    uint64 enabled = r_sstatus() & SSTATUS_SIE;
+
+    intr_off();
+    if (enabled) {
+        irqoff_stats[cpuid()].start = r_time();
+    }
+    return enabled;
+}
+
+void irq_restore(uint64 flags) {
+    if (flags) {
+        irqoff_account(irqoff_stats[cpuid()].start, "临界区");
+        intr_on();
+    }
+}
+
+int in_interrupt() {
+    return mycpu()->intr_depth > 0;
+}
+
+uint64 irqoff_max(int hart, const char **where) {
+    *where = irqoff_stats[hart].where ? irqoff_stats[hart].where : "无";
+    return irqoff_stats[hart].max;
+}
+
+// 致命错误：先输出延迟的日志，再挂起系统
+static void trap_hang(void) {
+    klog_flush();
+    console_flush();
+    while(1);
+}
+
+// 用户程序的致命异常只终止当前任务，返回1；来自内核的异常返回0
+static int kill_if_user(const char *reason) {
+    if (r_sstatus() & SSTATUS_SPP) {
+        return 0;
+    }
+    struct task *t = current_task();
+    console_printf_TRAP("pid %d (%s) %s，终止执行\n", t->pid, t->name, reason);
+    task_exit(-1);
+    return 1;
+}
+
+// 来自U模式的trap使用的内核栈，每个hart一个
+// 寄存器保存在任务的trap帧中，这个栈只在处理trap期间使用
+#define TRAP_STACK_SIZE 8192
+static uint8 trap_stack[NCPU][TRAP_STACK_SIZE] __attribute__((aligned(16)));
+
+uint64 trap_stack_top() {
+    return (uint64)&trap_stack[cpuid()][TRAP_STACK_SIZE];
+}
+
+// 外部中断：由PLIC驱动分发给注册的处理函数。设备发出中断的时刻无法得知，
+// 延迟统计以trap入口读到的时间为触发时刻
+static void extern_interrupt(uint64 entered) {
+    irq_latency_entry(IRQ_SRC_EXTERNAL, entered);
+    plic_dispatch();
+    irq_latency_exit(IRQ_SRC_EXTERNAL, entered);
+}
+
+// 准备返回U模式：下一次trap把寄存器保存到任务的trap帧，再切换到本hart的内核栈
+void trap_prepare_user(struct task *t) {
+    t->tf.kernel_sp = trap_stack_top();
+    t->tf.hartid = cpuid();
+    w_sscratch((uint64)&t->tf);
+}
+
+// 返回之前的公共处理：线程被杀死时退出，按需重新调度，设置sscratch
+// 返回要恢复的寄存器数组
+static uint64 *trap_exit_prepare(struct cpu *c, uint64 *regs) {
+    // 同进程的其他线程调用了exit：返回用户态之前退出
+    if ((r_sstatus() & SSTATUS_SPP) == 0 && c->cur->killed && c->cur->state != TASK_ZOMBIE) {
+        task_exit(-1);
+    }
+
+    // 时钟中断或系统调用（yield/sleep/exit等）请求了重新调度
+    if (c->need_resched) {
+        regs = schedule(regs);
+    }
+    
+    // 返回U模式时，下一次trap需要保存到任务的trap帧
+    if ((r_sstatus() & SSTATUS_SPP) == 0) {
+        trap_prepare_user(c->cur);
+    }
+    return regs;
+}
 
 /**
  * 中断处理函数
@@ -14,12 +137,41 @@ extern void trap_vector();
  * @param sepc   中断/异常发生时的程序计数器值
  * @param stval  中断/异常相关的附加信息
  * @param regs   保存的寄存器状态数组
+ * @return       要恢复的寄存器数组，切换任务时是下一个任务的上下文
  */
-void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
+uint64 *trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
     // 获取中断原因，低8位为具体原因码
     uint64 cause = scause & 0xff;
     // 最高位为1表示中断，为0表示异常
     int is_interrupt = (scause >> 63) & 1;
+    // trap处理期间中断一直是关闭的，记录开始时间用于关中断时间统计
+    uint64 trap_start = r_time();
+    struct cpu *c = mycpu();
+    
+    // 系统调用访问用户内存出错：跳到修复代码返回错误。不输出日志（出错时
+    // 可能持有控制台锁），不重新调度（还在系统调用中，使用的是本hart的trap栈），
+    // 也不改动trap_regs（仍指向系统调用保存的寄存器）
+    if (!is_interrupt && (cause == 13 || cause == 15) && (r_sstatus() & SSTATUS_SPP) &&
+        uaccess_fixup(sepc)) {
+        return regs;
+    }
+    
+    c->intr_depth++;
+    c->trap_regs = regs;
+    
+    // 内核线程通过S模式ecall请求调度，直接处理且不记录日志，
+    // 否则kworker输出日志时的ecall又会产生新的日志
+    if (!is_interrupt && cause == 9) {
+        w_sepc(sepc + 4);
+        regs[REG_A0] = syscall(regs[REG_A7], regs[REG_A0], regs[REG_A1], regs[REG_A2],
+                               regs[REG_A3], regs[REG_A4], regs[REG_A5]);
+        goto out;
+    }
+    
+    // U模式的浮点指令因FS为Off触发的非法指令：加载任务的浮点寄存器后重新执行
+    if (!is_interrupt && cause == 2 && (r_sstatus() & SSTATUS_SPP) == 0 && fpu_trap()) {
+        goto out;
+    }
     
     // 添加前缀以区分输出
     console_printf_TRAP("捕获到异常/中断\n");
@@ -38,8 +190,8 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
         switch (cause) {
             case 1: // 软件中断
                 console_printf_TRAP("软件中断\n");
-                // 清除软件中断标志位
-                w_sip(r_sip() & ~SIP_SSIP);
+                // 核间中断：由其他hart经M模式转发，清除SSIP后处理消息
+                ipi_handler();
                 break;
                 
             case 5: // 时钟中断
@@ -50,8 +202,7 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
                 
             case 9: // 外部中断
                 console_printf_TRAP("外部中断\n");
-                // 清除外部中断标志位
-                w_sip(r_sip() & ~SIP_SEIP);
+                extern_interrupt(trap_start);
                 break;
                 
             default:
@@ -91,18 +242,20 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
             case 8: // 环境调用（来自用户模式）
                 console_printf_TRAP("环境调用（来自用户模式）\n");
                 // 打印系统调用信息，系统调用号在a7(x17)寄存器中
-                console_printf_TRAP("系统调用号: %d\n", regs[16]);
-                console_printf_TRAP("参数1: 0x%lx\n", regs[9]);
-                console_printf_TRAP("参数2: 0x%lx\n", regs[10]);
+                console_printf_TRAP("系统调用号: %d\n", regs[REG_A7]);
+                console_printf_TRAP("参数1: 0x%lx\n", regs[REG_A0]);
+                console_printf_TRAP("参数2: 0x%lx\n", regs[REG_A1]);
+                
+                // 系统调用返回时，PC需要加4（跳过ecall指令）
+                // 必须在调用syscall之前设置，以便调度器切换任务时保存正确的sepc
+                w_sepc(sepc + 4);
                 
                 // 处理系统调用
                 // 系统调用号在a7寄存器中，参数在a0-a5寄存器中
                 // 返回值存放在a0寄存器中
-                regs[10] = syscall(regs[16], regs[9], regs[10], regs[11], regs[12], regs[13], regs[14]);
-                console_printf_TRAP("系统调用返回值: 0x%lx\n", regs[9]);
-                
-                // 系统调用返回时，PC需要加4（跳过ecall指令）
-                w_sepc(sepc + 4);
+                regs[REG_A0] = syscall(regs[REG_A7], regs[REG_A0], regs[REG_A1], regs[REG_A2],
+                                       regs[REG_A3], regs[REG_A4], regs[REG_A5]);
+                console_printf_TRAP("系统调用返回值: 0x%lx\n", regs[REG_A0]);
                 break;
                 
             case 12: // 指令页错误
@@ -110,8 +263,11 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
                 console_printf_TRAP("PC=0x%lx, 地址=0x%lx\n", sepc, stval);
                 // 打印当前页表基址，帮助调试
                 console_printf_TRAP("当前页表基址: 0x%lx\n", r_satp());
-                // 页错误通常是严重错误，暂停系统
-                while(1); // 暂停
+                if (kill_if_user("访问非法地址")) {
+                    break;
+                }
+                // 内核中的页错误是严重错误，暂停系统
+                trap_hang(); // 暂停
                 break;
                 
             case 13: // 加载页错误
@@ -119,7 +275,10 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
                 console_printf_TRAP("PC=0x%lx, 地址=0x%lx\n", sepc, stval);
                 // 打印当前页表基址
                 console_printf_TRAP("当前页表基址: 0x%lx\n", r_satp());
-                while(1); // 暂停
+                if (kill_if_user("访问非法地址")) {
+                    break;
+                }
+                trap_hang(); // 暂停
                 break;
                 
             case 15: // 存储页错误
@@ -127,7 +286,10 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
                 console_printf_TRAP("PC=0x%lx, 地址=0x%lx\n", sepc, stval);
                 // 打印当前页表基址
                 console_printf_TRAP("当前页表基址: 0x%lx\n", r_satp());
-                while(1); // 暂停
+                if (kill_if_user("访问非法地址")) {
+                    break;
+                }
+                trap_hang(); // 暂停
                 break;
                 
             default:
@@ -147,7 +309,7 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
                 }
                 
                 // 未知异常通常是严重错误，暂停系统
-                while(1); // 暂停
+                trap_hang(); // 暂停
                 break;
         }
     }
@@ -162,25 +324,84 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
         // 终止用户程序执行，而不是继续执行下一条指令
         console_printf_TRAP("程序遇到非法指令，终止执行\n");
         
-        // 可以选择以下方式之一:
-        
-        // 1. 终止进程 (如果有进程管理)
-        // exit(-1);
-        
-        // 2. 跳转到一个安全的位置
-        // tf->epc = (uint64)some_error_handler;
-        // return;
-        
-        // 3. 简单地挂起系统
-        console_printf_TRAP("系统挂起\n");
-        while(1) {
-            // 空循环，防止继续执行
+        // 用户程序：终止进程
+        // 内核：简单地挂起系统
+        if (!kill_if_user("遇到非法指令")) {
+            console_printf_TRAP("系统挂起\n");
+            trap_hang();
         }
     }
-    
 
+out:
+    regs = trap_exit_prepare(c, regs);
+    c->intr_depth--;
+    irqoff_account(trap_start, "trap");
+    return regs;
+}
 
-    
+/**
+ * 系统调用快速路径（entry.S的syscall_entry调用）
+ * regs是当前任务的trap帧，只保存了调用者保存的寄存器和用户的ra/sp/gp/tp，
+ * s0-s11还在寄存器中
+ *
+ * @return 非0表示需要走慢速返回路径（重新调度或线程被杀死）
+ */
+uint64 syscall_fast(uint64 *regs) {
+    uint64 entered = r_time();
+    struct cpu *c = mycpu();
+
+    c->intr_depth++;
+    c->trap_regs = regs;
+    w_sepc(r_sepc() + 4);
+    regs[REG_A0] = syscall(regs[REG_A7], regs[REG_A0], regs[REG_A1], regs[REG_A2],
+                           regs[REG_A3], regs[REG_A4], regs[REG_A5]);
+    c->intr_depth--;
+    // 系统调用处理函数在关中断下运行，同样计入关中断时间统计
+    irqoff_account(entered, "系统调用");
+
+    return c->need_resched || c->cur->killed;
+}
+
+/**
+ * 中断快速路径（向量模式下entry.S的intr_entry调用）
+ * 与syscall_fast一样只保存了调用者保存的寄存器，不解码scause也不输出日志
+ *
+ * @param cause  中断原因码（1软件、5时钟、9外部）
+ * @return 非0表示需要走慢速返回路径
+ */
+uint64 intr_fast(uint64 *regs, uint64 cause) {
+    uint64 entered = r_time();
+    struct cpu *c = mycpu();
+
+    c->intr_depth++;
+    c->trap_regs = regs;
+    switch (cause) {
+        case 1:
+            ipi_handler();
+            break;
+        case 5:
+            timer_handler();
+            break;
+        case 9:
+            extern_interrupt(entered);
+            break;
+    }
+    c->intr_depth--;
+    irqoff_account(entered, "中断");
+
+    return c->need_resched || ((r_sstatus() & SSTATUS_SPP) == 0 && c->cur->killed);
+}
+
+// 快速路径的慢速返回：entry.S已补存s0-s11，regs是完整的trap帧
+uint64 *trap_exit_slow(uint64 *regs) {
+    uint64 entered = r_time();
+    struct cpu *c = mycpu();
+
+    c->intr_depth++;
+    regs = trap_exit_prepare(c, regs);
+    c->intr_depth--;
+    irqoff_account(entered, "trap返回");
+    return regs;
 }
 
 /**
@@ -189,6 +410,11 @@ void trap_handler(uint64 scause, uint64 sepc, uint64 stval, uint64 *regs) {
  */
 void trap_init() {
     // 设置中断向量表地址
+#if TRAP_VECTORED
+    // 向量模式：时钟、软件和外部中断直接进入各自的入口
+    w_stvec((uint64)trap_vector_table | STVEC_MODE_VECTORED);
+#else
     w_stvec((uint64)trap_vector);
+#endif
     console_printf_TRAP("中断处理初始化完成，STVEC=0x%lx\n", r_stvec());
 }
\ No newline at end of file
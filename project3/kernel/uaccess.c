@@ -0,0 +1,75 @@
+// uaccess.c - 用户内存访问的范围检查和页错误修复
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/memlayout.h"
+#include "../include/uaccess.h"
+
+// uaccess.S
+uint64 __copy_user(void *dst, const void *src, uint64 n);
+int64 __strncpy_user(char *dst, const char *src, uint64 n);
+
+// 链接脚本定义的异常表边界
+extern struct exception_entry __ex_table_start[], __ex_table_end[];
+
+int access_ok(uint64 uaddr, uint64 n) {
+    return uaddr >= USER_BASE && uaddr <= USER_STACK_TOP && n <= USER_STACK_TOP - uaddr;
+}
+
+// 出错时嵌套的trap改写了sepc和sstatus的SPP/SPIE，
+// 恢复成系统调用返回用户态时需要的值
+static int copy_user(void *dst, const void *src, uint64 n) {
+    uint64 sepc = r_sepc();
+    uint64 sstatus = r_sstatus();
+
+    if (__copy_user(dst, src, n) == 0) {
+        return 0;
+    }
+    w_sepc(sepc);
+    w_sstatus(sstatus);
+    return -1;
+}
+
+int copy_from_user(void *dst, uint64 usrc, uint64 n) {
+    if (!access_ok(usrc, n)) {
+        return -1;
+    }
+    return copy_user(dst, (const void *)usrc, n);
+}
+
+int copy_to_user(uint64 udst, const void *src, uint64 n) {
+    if (!access_ok(udst, n)) {
+        return -1;
+    }
+    return copy_user((void *)udst, src, n);
+}
+
+// 字符串长度事先未知，只检查起始地址，复制范围截断到用户地址空间的结尾
+int64 strncpy_from_user(char *dst, uint64 usrc, uint64 n) {
+    if (usrc < USER_BASE || usrc >= USER_STACK_TOP) {
+        return -1;
+    }
+    if (n > USER_STACK_TOP - usrc) {
+        n = USER_STACK_TOP - usrc;
+    }
+
+    uint64 sepc = r_sepc();
+    uint64 sstatus = r_sstatus();
+    int64 len = __strncpy_user(dst, (const char *)usrc, n);
+    if (len < 0) {
+        w_sepc(sepc);
+        w_sstatus(sstatus);
+    }
+    return len;
+}
+
+// 表项很少（只有__copy_user和__strncpy_user中的指令），顺序查找即可
+int uaccess_fixup(uint64 sepc) {
+    for (struct exception_entry *e = __ex_table_start; e < __ex_table_end; e++) {
+        if (e->insn == sepc) {
+            w_sepc(e->fixup);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,4 +1,14 @@
+// uart.c - 16550串口，输出经发送缓冲区由中断驱动
+//
+// 锁顺序：控制台锁 -> uart_tx.lock -> sched_lock（写者在持有控制台锁时阻塞）
+// 接收到的字符交给console_rx（console.c）处理行规程
+
 #include "../include/uart.h"
+#include "../include/riscv.h"
+#include "../include/spinlock.h"
+#include "../include/sched.h"
+#include "../include/console.h"
+#include "../include/plic.h"
 
 // QEMU RISC-V的UART地址
 #define UART0 0x10000000ULL
@@ -7,14 +17,34 @@
 #define RHR 0    // 接收保持寄存器（读取时）
 #define THR 0    // 发送保持寄存器（写入时）
 #define IER 1    // 中断使能寄存器
-#define FCR 2    // FIFO控制寄存器
+#define FCR 2    // FIFO控制寄存器（写入时）
+#define ISR 2    // 中断状态寄存器（读取时）
 #define LCR 3    // 线路控制寄存器
 #define LSR 5    // 线路状态寄存器
 
+// IER位
+#define IER_RX_ENABLE (1<<0) // 接收数据就绪中断
+#define IER_TX_ENABLE (1<<1) // 发送保持寄存器空中断
+
 // LSR位
 #define LSR_RX_READY (1<<0)  // 输入就绪
 #define LSR_TX_IDLE  (1<<5)  // 发送空闲
 
+#define UART_FIFO    16      // 16550发送FIFO深度
+
+// 发送缓冲区：console_putc写入后立即返回，由发送保持寄存器空中断逐批发送。
+// 启用中断之前（启动早期、M模式）直接轮询发送
+static struct {
+    struct spinlock lock;
+    char buf[UART_TX_SIZE];
+    uint64 head;            // 下一个写入位置
+    uint64 tail;            // 下一个发送位置
+    int intr;               // 已启用发送中断
+    int waiting;            // 有用户任务在等待缓冲区空间
+    uint64 bytes;           // 写入串口的字节数
+    uint64 busy;            // 写入缓冲区、发送和等待花费的时间（timebase tick）
+} uart_tx = { .lock = SPINLOCK_INIT("uart") };
+
 // 读取UART寄存器
 static inline uint8 uart_read_reg(uint8 reg) {
     return *(volatile uint8*)(UART0 + reg);
@@ -38,17 +68,114 @@ void uart_init() {
     // 启用FIFO，清除FIFO，设置中断阈值
     uart_write_reg(FCR, 0x07);
     
-    // 启用发送和接收中断
-    uart_write_reg(IER, 0x03);
+    // 收发中断在PLIC初始化之后由uart_intr_enable启用
+}
+
+// 发送器空闲时把缓冲区中的数据写入FIFO，调用者持有uart_tx.lock
+static void uart_tx_start() {
+    if ((uart_read_reg(LSR) & LSR_TX_IDLE) == 0) {
+        return;
+    }
+    for (int i = 0; i < UART_FIFO && uart_tx.tail != uart_tx.head; i++) {
+        uart_write_reg(THR, uart_tx.buf[uart_tx.tail % UART_TX_SIZE]);
+        uart_tx.tail++;
+        uart_tx.bytes++;
+    }
+}
+
+static uint64 uart_tx_room() {
+    return UART_TX_SIZE - (uart_tx.head - uart_tx.tail);
+}
+
+// UART中断处理：接收的字符交给控制台，发送缓冲区中的数据写入FIFO
+static void uart_intr(int irq, void *arg) {
+    // 接收：读空接收FIFO，交给控制台的行规程（回显会获取uart_tx.lock，在这之前处理）
+    while (uart_has_data()) {
+        console_rx(uart_read_reg(RHR));
+    }
+
+    uint64 start = r_time();
+    uint64 flags = spin_lock_irqsave(&uart_tx.lock);
+
+    // 读取ISR清除发送保持寄存器空中断
+    uart_read_reg(ISR);
+    uart_tx_start();
+    // 空出一半以上再唤醒，避免每发送一批就唤醒一次写者
+    if (uart_tx.waiting && uart_tx_room() >= UART_TX_SIZE / 2) {
+        uart_tx.waiting = 0;
+        sched_wakeup_chan(&uart_tx);
+    }
+    uart_tx.busy += r_time() - start;
+    spin_unlock_irqrestore(&uart_tx.lock, flags);
+}
+
+// 串口中断只路由到hart 0：中断很频繁但每次的工作很少，固定在一个hart上
+// 避免多个hart竞争claim和uart_tx.lock
+int uart_intr_enable() {
+    if (request_irq(UART0_IRQ, uart_intr, NULL, 1, 1ULL << 0) < 0) {
+        return -1;
+    }
+    uint64 flags = spin_lock_irqsave(&uart_tx.lock);
+    uart_tx.intr = 1;
+    uart_write_reg(IER, IER_RX_ENABLE | IER_TX_ENABLE);
+    spin_unlock_irqrestore(&uart_tx.lock, flags);
+    return 0;
 }
 
 // 向UART发送一个字符
+// 缓冲区满时只能轮询发送腾出空间：调用者可能持有自旋锁或处于中断上下文，不能睡眠
 void uart_putc(char c) {
-    // 等待发送缓冲区空闲
-    while((uart_read_reg(LSR) & LSR_TX_IDLE) == 0);
-    
-    // 发送字符
-    uart_write_reg(THR, c);
+    uint64 start = r_time();
+    uint64 flags = spin_lock_irqsave(&uart_tx.lock);
+
+    if (!uart_tx.intr) {
+        while ((uart_read_reg(LSR) & LSR_TX_IDLE) == 0);
+        uart_write_reg(THR, c);
+        uart_tx.bytes++;
+    } else {
+        while (uart_tx_room() == 0) {
+            uart_tx_start();
+        }
+        uart_tx.buf[uart_tx.head % UART_TX_SIZE] = c;
+        uart_tx.head++;
+        // 缓冲区原来为空时发送器可能已经空闲，不会再有中断，需要在这里启动发送
+        if (uart_tx.head - uart_tx.tail == 1) {
+            uart_tx_start();
+        }
+    }
+    uart_tx.busy += r_time() - start;
+    spin_unlock_irqrestore(&uart_tx.lock, flags);
+}
+
+int uart_tx_wait(uint64 need, int nonblock) {
+    uint64 flags = spin_lock_irqsave(&uart_tx.lock);
+
+    if (!uart_tx.intr || uart_tx_room() >= need) {
+        spin_unlock_irqrestore(&uart_tx.lock, flags);
+        return 0;
+    }
+    if (nonblock) {
+        spin_unlock_irqrestore(&uart_tx.lock, flags);
+        return 1;
+    }
+    // 持有uart_tx.lock时阻塞：中断处理获取同一把锁之后才唤醒，不会丢失唤醒
+    uart_tx.waiting = 1;
+    sched_block(&uart_tx);
+    spin_unlock_irqrestore(&uart_tx.lock, flags);
+    return 1;
+}
+
+void uart_flush() {
+    uint64 flags = spin_lock_irqsave(&uart_tx.lock);
+    while (uart_tx.tail != uart_tx.head) {
+        uart_tx_start();
+    }
+    spin_unlock_irqrestore(&uart_tx.lock, flags);
+}
+
+void uart_stat(uint64 *bytes, uint64 *busy) {
+    *bytes = uart_tx.bytes;
+    *busy = uart_tx.busy;
 }
 
 // 从UART读取一个字符（如果有）
@@ -63,4 +190,4 @@ int uart_getc() {
 // 检查UART是否有数据可读
 int uart_has_data() {
     return (uart_read_reg(LSR) & LSR_RX_READY) != 0;
-}
\ No newline at end of file
+}
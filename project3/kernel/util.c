@@ -1,6 +1,7 @@
 // util.c
 #include "util.h"
 #include "console.h"
+#include "klog.h"
 
 /*---- 内存操作 ----*/
 void* memset(void* dst, int c, size_t n) {
@@ -20,6 +21,15 @@ void* memcpy(void* dst, const void* src, size_t n) {
     return dst;
 }
 
+/*---- 字符串操作 ----*/
+int strcmp(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
 /*---- 磁盘操作 ----*/
 void disk_read(void* dst, uint32 offset, uint32 count) {
     const char* src = (const char*)0x80000000 + offset;
@@ -33,6 +43,8 @@ void disk_read(void* dst, uint32 offset, uint32 count) {
 /*---- 错误处理 ----*/
 __attribute__((noreturn)) 
 void panic(const char* msg) {
+    // 先输出中断上下文中尚未输出的日志
+    klog_flush();
     console_printf_PANIC("内核错误: %s\n", msg);
     while (1) { 
         asm volatile("wfi"); 
@@ -0,0 +1,72 @@
+// vdso.c - 映射到用户地址空间的只读数据页
+//
+// 时间页是内核中的一个静态页，以PTE_NOFREE映射到所有进程，释放和fork
+// 时都不复制；进程页随地址空间分配，fork复制后改写为子进程的pid。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/memlayout.h"
+#include "../include/timer.h"
+#include "../include/vdso.h"
+#include "../include/vm.h"
+#include "../include/console.h"
+
+static union {
+    struct vdso_time t;
+    uint8 page[PGSIZE];
+} vdso_time_page __attribute__((aligned(PGSIZE)));
+
+void vdso_init() {
+    vdso_time_page.t.freq = CLOCK_FREQ;
+    vdso_set_clock(r_time());
+}
+
+// 只有hart 0在启动时写入，不需要写者之间的互斥
+void vdso_set_clock(uint64 offset) {
+    struct vdso_time *vt = &vdso_time_page.t;
+
+    vt->seq++;
+    __sync_synchronize();
+    vt->offset = offset;
+    __sync_synchronize();
+    vt->seq++;
+}
+
+uint64 vdso_clock_offset() {
+    struct vdso_time *vt = &vdso_time_page.t;
+    uint32 seq;
+    uint64 offset;
+
+    do {
+        seq = vt->seq;
+        __sync_synchronize();
+        offset = vt->offset;
+        __sync_synchronize();
+    } while ((seq & 1) || seq != vt->seq);
+    return offset;
+}
+
+int vdso_map(pagetable_t pagetable, int pid) {
+    if (mappages(pagetable, USER_VDATA, PGSIZE, (uint64)&vdso_time_page,
+                 PTE_U | PTE_R | PTE_NOFREE) < 0) {
+        return -1;
+    }
+
+    struct vdso_proc *vp = kalloc_zeroed();
+    if (!vp) {
+        return -1;
+    }
+    if (mappages(pagetable, USER_VDATA + PGSIZE, PGSIZE, (uint64)vp, PTE_U | PTE_R) < 0) {
+        kfree(vp);
+        return -1;
+    }
+    vp->pid = pid;
+    return 0;
+}
+
+void vdso_set_pid(pagetable_t pagetable, int pid) {
+    struct vdso_proc *vp = (struct vdso_proc *)walkaddr(pagetable, USER_VDATA + PGSIZE);
+    if (vp) {
+        vp->pid = pid;
+    }
+}
@@ -0,0 +1,195 @@
+// vm.c - Sv39页表管理
+//
+// 所有页表共享内核映射：顶级页表的第0项（设备）和第2项（物理内存）
+// 是1GB大页，用户页表直接复制这两项。用户地址空间只使用第1项。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/memlayout.h"
+#include "../include/kalloc.h"
+#include "../include/vm.h"
+#include "../include/util.h"
+#include "../include/console.h"
+
+pagetable_t kernel_pagetable;
+
+// 内核映射所在的顶级页表项
+#define KPX_DEVICES  PX(2, UART0_BASE)
+#define KPX_RAM      PX(2, RAMBASE)
+
+void kvminit() {
+    kernel_pagetable = (pagetable_t)kalloc_zeroed();
+    if (!kernel_pagetable) {
+        panic("kvminit: 无法分配内核页表");
+    }
+
+    // 设备（UART/CLINT/PLIC）：1GB大页，可读写不可执行
+    kernel_pagetable[KPX_DEVICES] = PA2PTE(0) | PTE_V | PTE_R | PTE_W | PTE_G | PTE_A | PTE_D;
+    // 物理内存：1GB大页，内核可读写执行
+    kernel_pagetable[KPX_RAM] = PA2PTE(RAMBASE) | PTE_V | PTE_R | PTE_W | PTE_X |
+                                PTE_G | PTE_A | PTE_D;
+
+    console_printf_PAGE("内核页表: 0x%lx\n", (uint64)kernel_pagetable);
+}
+
+void kvminithart() {
+    sfence_vma();
+    w_satp(MAKE_SATP(kernel_pagetable));
+    sfence_vma();
+}
+
+void vm_switch(pagetable_t pagetable) {
+    uint64 satp = MAKE_SATP(pagetable);
+    if (r_satp() != satp) {
+        w_satp(satp);
+        sfence_vma();
+    }
+}
+
+pte_t *walk(pagetable_t pagetable, uint64 va, int alloc) {
+    if (va < USER_BASE || va >= USER_STACK_TOP) {
+        return NULL;
+    }
+
+    for (int level = 2; level > 0; level--) {
+        pte_t *pte = &pagetable[PX(level, va)];
+        if (*pte & PTE_V) {
+            pagetable = (pagetable_t)PTE2PA(*pte);
+        } else {
+            if (!alloc || (pagetable = (pagetable_t)kalloc_zeroed()) == NULL) {
+                return NULL;
+            }
+            *pte = PA2PTE(pagetable) | PTE_V;
+        }
+    }
+    return &pagetable[PX(0, va)];
+}
+
+uint64 walkaddr(pagetable_t pagetable, uint64 va) {
+    pte_t *pte = walk(pagetable, va, 0);
+
+    if (!pte || (*pte & PTE_V) == 0 || (*pte & PTE_U) == 0) {
+        return 0;
+    }
+    return PTE2PA(*pte) + (va & (PGSIZE - 1));
+}
+
+int mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm) {
+    uint64 a = PGROUNDDOWN(va);
+    uint64 last = PGROUNDDOWN(va + size - 1);
+
+    for (;;) {
+        pte_t *pte = walk(pagetable, a, 1);
+        if (!pte) {
+            return -1;
+        }
+        if (*pte & PTE_V) {
+            panic("mappages: 重复映射");
+        }
+        *pte = PA2PTE(pa) | perm | PTE_V;
+        if (a == last) {
+            break;
+        }
+        a += PGSIZE;
+        pa += PGSIZE;
+    }
+    return 0;
+}
+
+pagetable_t uvmcreate() {
+    pagetable_t pagetable = (pagetable_t)kalloc_zeroed();
+    if (!pagetable) {
+        return NULL;
+    }
+    pagetable[KPX_DEVICES] = kernel_pagetable[KPX_DEVICES];
+    pagetable[KPX_RAM] = kernel_pagetable[KPX_RAM];
+    return pagetable;
+}
+
+// 递归释放页表，level为该页表所在级别
+static void freewalk(pagetable_t pagetable, int level) {
+    for (int i = 0; i < 512; i++) {
+        pte_t pte = pagetable[i];
+        if ((pte & PTE_V) == 0) {
+            continue;
+        }
+        if (level == 2 && (i == KPX_DEVICES || i == KPX_RAM)) {
+            continue;   // 共享的内核映射
+        }
+        if ((pte & (PTE_R | PTE_W | PTE_X)) == 0) {
+            freewalk((pagetable_t)PTE2PA(pte), level - 1);
+        } else if ((pte & PTE_NOFREE) == 0) {
+            kfree((void *)PTE2PA(pte));
+        }
+        pagetable[i] = 0;
+    }
+    kfree(pagetable);
+}
+
+void uvmfree(pagetable_t pagetable) {
+    freewalk(pagetable, 2);
+}
+
+int uvmcopy(pagetable_t old, pagetable_t new) {
+    pte_t l2 = old[PX(2, USER_BASE)];
+    if ((l2 & PTE_V) == 0) {
+        return 0;
+    }
+
+    // 用户空间只在第1个顶级项下，直接遍历下两级页表，跳过空的2MB区域
+    pagetable_t l1 = (pagetable_t)PTE2PA(l2);
+    for (int i = 0; i < 512; i++) {
+        if ((l1[i] & PTE_V) == 0) {
+            continue;
+        }
+        pagetable_t l0 = (pagetable_t)PTE2PA(l1[i]);
+        for (int j = 0; j < 512; j++) {
+            pte_t pte = l0[j];
+            if ((pte & PTE_V) == 0) {
+                continue;
+            }
+            uint64 va = USER_BASE + ((uint64)i << PXSHIFT(1)) + ((uint64)j << PXSHIFT(0));
+            uint64 pa = PTE2PA(pte);
+            int perm = PTE_FLAGS(pte) & ~PTE_V;
+
+            if ((pte & PTE_NOFREE) == 0) {
+                void *page = kalloc();
+                if (!page) {
+                    return -1;
+                }
+                memcpy(page, (void *)pa, PGSIZE);
+                pa = (uint64)page;
+            }
+            if (mappages(new, va, PGSIZE, pa, perm) < 0) {
+                if ((pte & PTE_NOFREE) == 0) {
+                    kfree((void *)pa);
+                }
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int copyout(pagetable_t pagetable, uint64 dstva, const void *src, uint64 len) {
+    const char *s = src;
+
+    while (len > 0) {
+        uint64 va0 = PGROUNDDOWN(dstva);
+        // 只读页（vDSO数据页、直接映射的initramfs页）不能由内核代为写入
+        pte_t *pte = walk(pagetable, va0, 0);
+        if (!pte || (*pte & (PTE_V | PTE_U | PTE_W)) != (PTE_V | PTE_U | PTE_W)) {
+            return -1;
+        }
+        uint64 pa0 = PTE2PA(*pte);
+        uint64 n = PGSIZE - (dstva - va0);
+        if (n > len) {
+            n = len;
+        }
+        memcpy((void *)(pa0 + (dstva - va0)), s, n);
+        len -= n;
+        s += n;
+        dstva += n;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// workqueue.c - 每个hart的延迟工作队列（中断下半部）
+//
+// 中断处理函数（上半部）只做必须立即完成的工作，其余的工作通过
+// queue_work/raise_softirq交给本hart的kworker内核线程，
+// kworker在开中断的状态下执行这些工作。
+//
+// 隔离的hart上没有kworker，它们提交的工作交给hart 0处理，
+// 因此每个队列都有自己的锁。
+
+#include "../include/types.h"
+#include "../include/riscv.h"
+#include "../include/proc.h"
+#include "../include/sched.h"
+#include "../include/kthread.h"
+#include "../include/workqueue.h"
+#include "../include/trap.h"
+#include "../include/util.h"
+#include "../include/console.h"
+#include "../include/ipi.h"
+
+struct workqueue_cpu {
+    struct spinlock lock;   // 其他hart（隔离的hart）也会向本队列提交
+    struct work *head;
+    struct work *tail;
+    uint32 softirq_pending;
+
+    struct task *worker;
+};
+
+static struct workqueue_cpu wq_cpus[NCPU];
+static void (*softirq_vec[NR_SOFTIRQS])(void);
+
+// 当前hart提交工作的目标队列：隔离的hart交给hart 0
+static struct workqueue_cpu *this_wq(void) {
+    int id = cpuid();
+    return &wq_cpus[cpu_isolated(id) ? 0 : id];
+}
+
+// 唤醒队列的kworker，调用者持有wq->lock
+// 调用者可能持有sched_lock（例如调度器中的日志），所以不调用sched_wakeup，
+// 而是把唤醒时间置0，由kworker所在hart的下一次schedule唤醒它
+static void wake_worker(struct workqueue_cpu *wq) {
+    if (wq->worker && wq->worker->state == TASK_SLEEPING) {
+        wq->worker->wakeup_time = 0;
+        if (wq->worker->cpu == cpuid()) {
+            mycpu()->need_resched = 1;
+        } else {
+            ipi_resched(wq->worker->cpu);
+        }
+    }
+}
+
+void queue_work(struct work *w) {
+    struct workqueue_cpu *wq = this_wq();
+    uint64 flags = spin_lock_irqsave(&wq->lock);
+
+    // 同一个工作项可能同时在多个hart上被提交，只有一个能加入队列
+    if (__sync_bool_compare_and_swap(&w->pending, 0, 1)) {
+        w->next = NULL;
+        if (wq->tail) {
+            wq->tail->next = w;
+        } else {
+            wq->head = w;
+        }
+        wq->tail = w;
+        wake_worker(wq);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void open_softirq(int nr, void (*fn)(void)) {
+    softirq_vec[nr] = fn;
+}
+
+void raise_softirq(int nr) {
+    struct workqueue_cpu *wq = this_wq();
+    uint64 flags = spin_lock_irqsave(&wq->lock);
+
+    wq->softirq_pending |= 1U << nr;
+    wake_worker(wq);
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// 执行所有挂起的软中断
+static void run_softirqs(struct workqueue_cpu *wq) {
+    uint64 flags = spin_lock_irqsave(&wq->lock);
+    uint32 pending = wq->softirq_pending;
+    wq->softirq_pending = 0;
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    for (int nr = 0; pending; nr++, pending >>= 1) {
+        if ((pending & 1) && softirq_vec[nr]) {
+            softirq_vec[nr]();
+        }
+    }
+}
+
+// 执行队列中的工作项
+static void run_works(struct workqueue_cpu *wq) {
+    while (1) {
+        uint64 flags = spin_lock_irqsave(&wq->lock);
+        struct work *w = wq->head;
+        if (!w) {
+            spin_unlock_irqrestore(&wq->lock, flags);
+            break;
+        }
+        wq->head = w->next;
+        if (!wq->head) {
+            wq->tail = NULL;
+        }
+        w->pending = 0;
+        spin_unlock_irqrestore(&wq->lock, flags);
+
+        w->fn(w);
+    }
+}
+
+// kworker线程主循环
+static void kworker_main(void *arg) {
+    struct workqueue_cpu *wq = arg;
+
+    while (1) {
+        run_softirqs(wq);
+        run_works(wq);
+
+        // 在队列锁内再检查一次并标记睡眠：提交方（包括隔离的hart）在同一把锁内
+        // 检查kworker的状态，不会在检查和睡眠之间丢失唤醒
+        // 切换出去时保持关中断，睡眠期间不属于关中断临界区，不计入irq_save统计
+        intr_off();
+        uint64 flags = spin_lock_irqsave(&wq->lock);
+        int idle = !wq->softirq_pending && !wq->head;
+        if (idle) {
+            kthread_park_prepare();
+        }
+        spin_unlock_irqrestore(&wq->lock, flags);
+        if (idle) {
+            kthread_yield();
+        }
+        intr_on();
+    }
+}
+
+void workqueue_init() {
+    int id = cpuid();
+    struct workqueue_cpu *wq = &wq_cpus[id];
+    char name[] = "kworker/0";
+
+    // 隔离的hart不运行后台工作，它的工作由hart 0的kworker处理
+    if (cpu_isolated(id)) {
+        return;
+    }
+    spin_init(&wq->lock, "workqueue");
+    name[8] = '0' + id;
+    wq->worker = kthread_create_on(name, kworker_main, wq, id);
+    if (!wq->worker) {
+        panic("无法创建kworker线程");
+    }
+}
@@ -0,0 +1,222 @@
+// printf.c - 内核和用户库共用的格式化实现
+//
+// 输出先写入调用者提供的缓冲区，满了才交给flush，内核控制台和用户库的printf
+// 都以整块输出，而不是每个字符一次串口写入或系统调用。
+// 十进制每次除以100产生两位数字，并用查表得到这两位字符；除以常数由编译器
+// 换成乘法和移位，不执行除法指令。十六进制用移位和掩码。
+
+#include "../include/types.h"
+#include "../include/printf.h"
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void pb_put(struct printbuf *pb, const char *s, size_t n) {
+    pb->total += n;
+    while (n > 0) {
+        if (pb->len == pb->size) {
+            if (!pb->flush) {
+                return;
+            }
+            pb->flush(pb);
+        }
+        size_t m = pb->size - pb->len < n ? pb->size - pb->len : n;
+        char *d = pb->buf + pb->len;
+        for (size_t i = 0; i < m; i++) {
+            d[i] = s[i];
+        }
+        pb->len += m;
+        s += m;
+        n -= m;
+    }
+}
+
+// 输出n个字符c（宽度填充）
+static void pb_fill(struct printbuf *pb, char c, int n) {
+    char pad[16];
+    for (int i = 0; i < (int)sizeof(pad); i++) {
+        pad[i] = c;
+    }
+    while (n > 0) {
+        int m = n < (int)sizeof(pad) ? n : (int)sizeof(pad);
+        pb_put(pb, pad, m);
+        n -= m;
+    }
+}
+
+// 把v的十进制数字写到end之前，返回第一个数字的位置
+static char *fmt_dec(char *end, uint64 v) {
+    char *p = end;
+    while (v >= 100) {
+        uint64 q = v / 100;
+        uint32 r = (uint32)(v - q * 100) * 2;
+        p -= 2;
+        p[0] = digit_pairs[r];
+        p[1] = digit_pairs[r + 1];
+        v = q;
+    }
+    if (v >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[v * 2];
+        p[1] = digit_pairs[v * 2 + 1];
+    } else {
+        *--p = '0' + v;
+    }
+    return p;
+}
+
+static char *fmt_hex(char *end, uint64 v) {
+    char *p = end;
+    do {
+        *--p = hex_digits[v & 0xf];
+        v >>= 4;
+    } while (v);
+    return p;
+}
+
+// 输出一个数字：符号或0x前缀、宽度填充和数字
+static void put_number(struct printbuf *pb, const char *prefix, int plen,
+                       const char *digits, int n, int width, int zero) {
+    int pad = width - plen - n;
+
+    if (pad > 0 && !zero) {
+        pb_fill(pb, ' ', pad);
+    }
+    pb_put(pb, prefix, plen);
+    if (pad > 0 && zero) {
+        pb_fill(pb, '0', pad);
+    }
+    pb_put(pb, digits, n);
+}
+
+int vbprintf(struct printbuf *pb, const char *fmt, va_list args) {
+    size_t start = pb->total;
+    char num[24];
+    char *end = num + sizeof(num);
+
+    while (*fmt) {
+        // 一次输出到下一个%之前的所有普通字符
+        const char *lit = fmt;
+        while (*fmt && *fmt != '%') {
+            fmt++;
+        }
+        if (fmt > lit) {
+            pb_put(pb, lit, fmt - lit);
+        }
+        if (!*fmt) {
+            break;
+        }
+
+        const char *spec = fmt++;
+        int zero = 0, width = 0, is_long = 0;
+        if (*fmt == '0') {
+            zero = 1;
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9') {
+            width = width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == 'l') {
+            is_long = 1;
+            fmt++;
+        }
+        if (!*fmt) {
+            break;
+        }
+
+        char c = *fmt++;
+        switch (c) {
+            case 'c': {
+                char ch = (char)va_arg(args, int);
+                if (width > 1) {
+                    pb_fill(pb, ' ', width - 1);
+                }
+                pb_put(pb, &ch, 1);
+                break;
+            }
+
+            case 's': {
+                const char *s = va_arg(args, const char *);
+                if (!s) {
+                    s = "(null)";
+                }
+                int len = 0;
+                while (s[len]) {
+                    len++;
+                }
+                if (width > len) {
+                    pb_fill(pb, ' ', width - len);
+                }
+                pb_put(pb, s, len);
+                break;
+            }
+
+            case 'd': {
+                int64 v = is_long ? va_arg(args, int64) : va_arg(args, int);
+                uint64 u = v < 0 ? -(uint64)v : (uint64)v;
+                char *p = fmt_dec(end, u);
+                put_number(pb, "-", v < 0, p, end - p, width, zero);
+                break;
+            }
+
+            case 'u': {
+                uint64 u = is_long ? va_arg(args, uint64) : va_arg(args, uint32);
+                char *p = fmt_dec(end, u);
+                put_number(pb, "", 0, p, end - p, width, zero);
+                break;
+            }
+
+            case 'x': {
+                uint64 u = is_long ? va_arg(args, uint64) : va_arg(args, uint32);
+                char *p = fmt_hex(end, u);
+                put_number(pb, "", 0, p, end - p, width, zero);
+                break;
+            }
+
+            case 'p': {
+                char *p = fmt_hex(end, (uint64)va_arg(args, void *));
+                put_number(pb, "0x", 2, p, end - p, width, zero);
+                break;
+            }
+
+            case '%':
+                pb_put(pb, "%", 1);
+                break;
+
+            default:
+                // 未知格式，输出原样
+                pb_put(pb, spec, fmt - spec);
+                break;
+        }
+    }
+
+    if (pb->flush && pb->len) {
+        pb->flush(pb);
+    }
+    return pb->total - start;
+}
+
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list args) {
+    // 留出结尾'\0'的位置
+    struct printbuf pb = PRINTBUF_INIT(buf, size ? size - 1 : 0, NULL, NULL);
+    int n = vbprintf(&pb, fmt, args);
+
+    if (size) {
+        buf[pb.len] = '\0';
+    }
+    return n;
+}
+
+int snprintf(char *buf, size_t size, const char *fmt, ...) {
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return n;
+}
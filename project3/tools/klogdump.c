@@ -0,0 +1,219 @@
+// klogdump.c - 在主机上解码内核的二进制日志跟踪（KLOG_BINARY=1）
+//
+// 用法: klogdump <kernel.elf> [串口输出文件]
+// 从文件或标准输入读取串口输出，普通文本原样输出；以0xff开头的帧按
+// kernel.elf中.klog_fmt段的格式串解码（帧格式见kernel/klog.c的klog_emit_trace）。
+// 结束时在标准错误上报告帧的字节数和解码后的字节数。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <elf.h>
+
+static const char *fmt_sec;     // .klog_fmt段的内容
+static unsigned long fmt_size;
+
+static unsigned long nframes, frame_bytes, text_bytes;
+
+static void load_fmt_section(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *elf = malloc(size);
+    if (!elf || fread(elf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "klogdump: 读取%s失败\n", path);
+        exit(1);
+    }
+    fclose(f);
+
+    Elf64_Ehdr *eh = (Elf64_Ehdr *)elf;
+    if (size < (long)sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+        eh->e_ident[EI_CLASS] != ELFCLASS64 || eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > (uint64_t)size) {
+        fprintf(stderr, "klogdump: %s不是有效的64位ELF文件\n", path);
+        exit(1);
+    }
+    Elf64_Shdr *sh = (Elf64_Shdr *)(elf + eh->e_shoff);
+    const char *names = elf + sh[eh->e_shstrndx].sh_offset;
+
+    for (int i = 0; i < eh->e_shnum; i++) {
+        if (strcmp(names + sh[i].sh_name, ".klog_fmt") == 0) {
+            fmt_sec = elf + sh[i].sh_offset;
+            fmt_size = sh[i].sh_size;
+            return;
+        }
+    }
+    fprintf(stderr, "klogdump: %s中没有.klog_fmt段（内核需要用KLOG_BINARY=1编译）\n", path);
+    exit(1);
+}
+
+// 帧内参数的读取位置
+struct reader {
+    const unsigned char *p;
+    const unsigned char *end;
+};
+
+static uint64_t get_varint(struct reader *r) {
+    uint64_t v = 0;
+    int shift = 0;
+    while (r->p < r->end && shift < 64) {
+        unsigned char b = *r->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+        shift += 7;
+    }
+    // zigzag解码
+    return (v >> 1) ^ -(v & 1);
+}
+
+static const char *get_string(struct reader *r) {
+    const char *s = (const char *)r->p;
+    while (r->p < r->end && *r->p) {
+        r->p++;
+    }
+    if (r->p == r->end) {
+        return "(截断)";
+    }
+    r->p++;
+    return s;
+}
+
+// 按内核格式化（lib/printf.c）的规则输出：%[0][宽度][l]c/s/d/u/x/p/%
+static int format(const char *fmt, struct reader *r) {
+    int count = 0;
+    char c;
+
+    while ((c = *fmt++)) {
+        if (c != '%') {
+            putchar(c);
+            count++;
+            continue;
+        }
+        c = *fmt++;
+        if (!c) {
+            break;
+        }
+        int zero = 0, width = 0, is_long = 0;
+        if (c == '0') {
+            zero = 1;
+            c = *fmt++;
+        }
+        while (c >= '0' && c <= '9') {
+            width = width * 10 + (c - '0');
+            c = *fmt++;
+        }
+        if (c == 'l') {
+            is_long = 1;
+            c = *fmt++;
+        }
+        switch (c) {
+            case 'c':
+                count += printf("%*c", width, (char)get_varint(r));
+                break;
+            case 's':
+                count += printf("%*s", width, get_string(r));
+                break;
+            case 'd': {
+                int64_t v = get_varint(r);
+                long long d = is_long ? (long long)v : (long long)(int32_t)v;
+                count += printf(zero ? "%0*lld" : "%*lld", width, d);
+                break;
+            }
+            case 'u':
+            case 'x': {
+                uint64_t v = get_varint(r);
+                unsigned long long u = is_long ? v : (uint32_t)v;
+                if (c == 'u') {
+                    count += printf(zero ? "%0*llu" : "%*llu", width, u);
+                } else {
+                    count += printf(zero ? "%0*llx" : "%*llx", width, u);
+                }
+                break;
+            }
+            case 'p': {
+                // 宽度包括0x前缀
+                unsigned long long v = get_varint(r);
+                char hex[24];
+                snprintf(hex, sizeof(hex), "0x%llx", v);
+                if (zero) {
+                    count += printf("0x%0*llx", width > 2 ? width - 2 : 0, v);
+                } else {
+                    count += printf("%*s", width, hex);
+                }
+                break;
+            }
+            case '%':
+                putchar('%');
+                count++;
+                break;
+            case '\0':
+                return count;
+            default:
+                count += printf("%%%s%.0d%s%c", zero ? "0" : "", width, is_long ? "l" : "", c);
+                break;
+        }
+    }
+    return count;
+}
+
+static void decode_frame(const unsigned char *frame, int len) {
+    struct reader r = { frame + 4, frame + len };
+
+    nframes++;
+    frame_bytes += len + 2;
+    if (len < 4) {
+        printf("[klogdump: 帧太短]\n");
+        return;
+    }
+    unsigned prefix_id = frame[0] | frame[1] << 8;
+    unsigned fmt_id = frame[2] | frame[3] << 8;
+    if (prefix_id >= fmt_size || fmt_id >= fmt_size) {
+        printf("[klogdump: 未知的格式ID %u/%u，kernel.elf与运行的内核不一致?]\n", prefix_id, fmt_id);
+        return;
+    }
+    text_bytes += printf("%s", fmt_sec + prefix_id);
+    text_bytes += format(fmt_sec + fmt_id, &r);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "用法: %s <kernel.elf> [串口输出文件]\n", argv[0]);
+        return 1;
+    }
+    load_fmt_section(argv[1]);
+
+    FILE *in = stdin;
+    if (argc == 3 && !(in = fopen(argv[2], "rb"))) {
+        perror(argv[2]);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    int c;
+    while ((c = getc(in)) != EOF) {
+        if (c != 0xff) {
+            putchar(c);
+            continue;
+        }
+        int len = getc(in);
+        unsigned char frame[256];
+        if (len == EOF || fread(frame, 1, len, in) != (size_t)len) {
+            break;
+        }
+        decode_frame(frame, len);
+    }
+
+    if (nframes) {
+        fprintf(stderr, "klogdump: %lu 条日志, 帧 %lu 字节, 解码后 %lu 字节 (%.1fx)\n",
+                nframes, frame_bytes, text_bytes, (double)text_bytes / frame_bytes);
+    }
+    return 0;
+}
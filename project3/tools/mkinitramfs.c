@@ -0,0 +1,119 @@
+// mkinitramfs.c - 在主机上把用户程序打包成cpio newc归档
+//
+// 用法: mkinitramfs <输出文件> <名称>=<路径> ...
+// 每个文件的数据在归档内按4096字节对齐（前面插入名为".pad"的填充项），
+// 这样内核可以把ELF中的只读页直接映射到用户地址空间。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE 4096
+#define HDR_SIZE  110
+#define ALIGN4(x) (((x) + 3) & ~3UL)
+
+static unsigned long offset;
+
+static void put_bytes(FILE *out, const void *buf, unsigned long len) {
+    if (len && fwrite(buf, 1, len, out) != len) {
+        perror("mkinitramfs: 写入失败");
+        exit(1);
+    }
+    offset += len;
+}
+
+static void put_zero(FILE *out, unsigned long len) {
+    static const char zero[PAGE_SIZE];
+    while (len > 0) {
+        unsigned long n = len < PAGE_SIZE ? len : PAGE_SIZE;
+        put_bytes(out, zero, n);
+        len -= n;
+    }
+}
+
+// 写入一个完整的归档项：头部、文件名、数据，各自补齐到4字节
+static void put_entry(FILE *out, const char *name, unsigned int mode,
+                      const void *data, unsigned long size) {
+    static unsigned int ino = 1;
+    char hdr[HDR_SIZE + 1];     // newc头部的数值字段都是32位
+    unsigned long namesize = strlen(name) + 1;
+
+    snprintf(hdr, sizeof(hdr),
+             "070701%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X",
+             ino++, mode, 0u, 0u, 1u, 0u, (unsigned int)size, 0u, 0u, 0u, 0u,
+             (unsigned int)namesize, 0u);
+    put_bytes(out, hdr, HDR_SIZE);
+    put_bytes(out, name, namesize);
+    put_zero(out, ALIGN4(offset) - offset);
+    if (data) {
+        put_bytes(out, data, size);
+    } else {
+        put_zero(out, size);
+    }
+    put_zero(out, ALIGN4(offset) - offset);
+}
+
+// 插入填充项，使下一个名为name的文件数据从页边界开始
+static void put_pad(FILE *out, const char *name) {
+    unsigned long pad_hdr = ALIGN4(HDR_SIZE + sizeof(".pad"));
+    unsigned long file_hdr = ALIGN4(HDR_SIZE + strlen(name) + 1);
+    unsigned long end = offset + pad_hdr + file_hdr;
+    unsigned long pad = (PAGE_SIZE - end % PAGE_SIZE) % PAGE_SIZE;
+
+    if ((offset + file_hdr) % PAGE_SIZE == 0) {
+        return;
+    }
+    put_entry(out, ".pad", 0100644, NULL, pad);
+}
+
+static void *read_file(const char *path, unsigned long *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    void *buf = malloc(*size ? *size : 1);
+    if (!buf || fread(buf, 1, *size, f) != *size) {
+        fprintf(stderr, "mkinitramfs: 读取%s失败\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "用法: %s <输出文件> <名称>=<路径> ...\n", argv[0]);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "wb");
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        char *eq = strchr(argv[i], '=');
+        if (!eq) {
+            fprintf(stderr, "mkinitramfs: 参数格式应为 名称=路径: %s\n", argv[i]);
+            return 1;
+        }
+        *eq = '\0';
+
+        unsigned long size;
+        void *data = read_file(eq + 1, &size);
+        put_pad(out, argv[i]);
+        put_entry(out, argv[i], 0100755, data, size);
+        printf("initramfs: %-12s %8lu 字节\n", argv[i], size);
+        free(data);
+    }
+    put_entry(out, "TRAILER!!!", 0, NULL, 0);
+
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,31 @@
+// cat.c - 把标准输入或参数指定的文件复制到标准输出
+
+#include "ulib.h"
+
+static int copy(int fd) {
+    char buf[256];
+    int n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        if (write(1, buf, n) != n) {
+            return -1;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc <= 1) {
+        return copy(0) < 0 ? 1 : 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        int fd = open(argv[i], O_RDONLY);
+        if (fd < 0) {
+            printf("cat: 无法打开 %s\n", argv[i]);
+            return 1;
+        }
+        copy(fd);
+        close(fd);
+    }
+    return 0;
+}
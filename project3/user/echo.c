@@ -0,0 +1,13 @@
+// echo.c - 打印命令行参数，用于验证exec的参数传递
+
+#include "ulib.h"
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        printf("%s%s", argv[i], i + 1 < argc ? " " : "\n");
+    }
+    if (argc <= 1) {
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+// ring.c - 提交/完成队列的用户端
+//
+// 用户只推进sq_tail和cq_head。放入提交项和推进下标之间有内存屏障，
+// 保证内核看到新的sq_tail时提交项已经写好；完成项的可见性由内核保证。
+
+#include "ulib.h"
+
+int ring_prep(struct ring_shared *r, uint32 op, int fd, uint64 addr, uint64 len, uint64 user_data) {
+    if (r->sq_tail - r->sq_head >= RING_ENTRIES) {
+        return -1;
+    }
+
+    struct ring_sqe *sqe = &r->sqes[r->sq_tail % RING_ENTRIES];
+    sqe->op = op;
+    sqe->fd = fd;
+    sqe->addr = addr;
+    sqe->len = len;
+    sqe->user_data = user_data;
+    __sync_synchronize();
+    r->sq_tail++;
+    return 0;
+}
+
+uint32 ring_pending(struct ring_shared *r) {
+    return r->sq_tail - r->sq_head;
+}
+
+int ring_reap(struct ring_shared *r, struct ring_cqe *cqe) {
+    if (r->cq_head == r->cq_tail) {
+        return -1;
+    }
+    __sync_synchronize();
+    *cqe = r->cqes[r->cq_head % RING_ENTRIES];
+    r->cq_head++;
+    return 0;
+}
+
+int ring_submit(struct ring_shared *r) {
+    uint32 n = ring_pending(r);
+    return n ? ring_enter(n) : 0;
+}
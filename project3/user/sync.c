@@ -0,0 +1,92 @@
+// sync.c - 基于futex的互斥锁、条件变量和信号量
+//
+// 快速路径只有一次原子操作，只有确实需要睡眠或唤醒时才调用futex。
+
+#include "ulib.h"
+
+void mutex_init(mutex_t *m) {
+    m->state = 0;
+}
+
+int mutex_trylock(mutex_t *m) {
+    return __sync_bool_compare_and_swap(&m->state, 0, 1) ? 0 : -1;
+}
+
+void mutex_lock(mutex_t *m) {
+    int c = __sync_val_compare_and_swap(&m->state, 0, 1);
+    if (c == 0) {
+        return;
+    }
+
+    // 有竞争：把状态标记为2，告诉持有者解锁时需要唤醒
+    if (c != 2) {
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+    while (c != 0) {
+        futex_wait(&m->state, 2);
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void mutex_unlock(mutex_t *m) {
+    // 原状态为1说明没有等待者，不需要进入内核
+    if (__sync_fetch_and_sub(&m->state, 1) != 1) {
+        m->state = 0;
+        futex_wake(&m->state, 1);
+    }
+}
+
+void cond_init(cond_t *c) {
+    c->seq = 0;
+}
+
+void cond_wait(cond_t *c, mutex_t *m) {
+    int seq = c->seq;
+
+    mutex_unlock(m);
+    // 解锁后序号已变化说明错过了signal，futex_wait直接返回
+    futex_wait(&c->seq, seq);
+
+    // 被唤醒的线程与其他等待者竞争互斥锁，按有竞争的方式加锁，
+    // 保证解锁时会唤醒下一个等待者
+    while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex_wait(&m->state, 2);
+    }
+}
+
+void cond_signal(cond_t *c) {
+    __sync_fetch_and_add(&c->seq, 1);
+    futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t *c) {
+    __sync_fetch_and_add(&c->seq, 1);
+    futex_wake(&c->seq, 0x7fffffff);
+}
+
+void sem_init(sem_t *s, int value) {
+    s->count = value;
+    s->waiters = 0;
+}
+
+void sem_wait(sem_t *s) {
+    while (1) {
+        int c = s->count;
+        if (c > 0) {
+            if (__sync_bool_compare_and_swap(&s->count, c, c - 1)) {
+                return;
+            }
+            continue;
+        }
+        __sync_fetch_and_add(&s->waiters, 1);
+        futex_wait(&s->count, 0);
+        __sync_fetch_and_sub(&s->waiters, 1);
+    }
+}
+
+void sem_post(sem_t *s) {
+    __sync_fetch_and_add(&s->count, 1);
+    if (s->waiters > 0) {
+        futex_wake(&s->count, 1);
+    }
+}
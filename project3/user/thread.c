@@ -0,0 +1,145 @@
+// thread.c - 用户态线程库
+//
+// 每个线程的内存块由sbrk分配，布局为：
+//   [ 栈 ........ ][ struct uthread ][ TLS块 ]
+//                 ^栈顶             ^tp
+// RISC-V的TLS采用variant I：tp指向TLS块起点，__thread变量按链接时确定的
+// 偏移相对tp访问，因此线程描述符放在tp之前，thread_self只需读取tp。
+
+#include "ulib.h"
+
+#define THREAD_STACK_SIZE 16384
+
+// 链接脚本定义：.tdata的初始内容和整个TLS段的结束位置
+extern char __tdata_start[], __tdata_end[], __tls_end[];
+
+struct uthread {
+    int tid;
+    volatile int alive;         // 线程退出时由内核清零并futex唤醒（clone的ctid）
+    void *(*fn)(void *);
+    void *arg;
+    void *ret;
+    struct uthread *next;       // 空闲链表
+} __attribute__((aligned(16)));
+
+// 主线程TLS为空时使用的描述符
+static struct uthread main_thread;
+
+// 已join的线程块，按相同大小重复使用
+static struct uthread *free_list;
+static mutex_t free_lock = MUTEX_INITIALIZER;
+
+static uint64 tls_size(void) {
+    return ((uint64)(__tls_end - __tdata_start) + 15) & ~15ULL;
+}
+
+// 初始化TLS块：复制.tdata，.tbss部分清零
+static void tls_init(char *tls) {
+    uint64 n = __tdata_end - __tdata_start;
+    uint64 size = tls_size();
+
+    for (uint64 i = 0; i < size; i++) {
+        tls[i] = i < n ? __tdata_start[i] : 0;
+    }
+}
+
+// 分配一个线程块，返回其中的描述符
+static struct uthread *thread_alloc(void) {
+    struct uthread *t;
+
+    mutex_lock(&free_lock);
+    t = free_list;
+    if (t) {
+        free_list = t->next;
+    }
+    mutex_unlock(&free_lock);
+
+    if (!t) {
+        char *mem = sbrk(THREAD_STACK_SIZE + sizeof(struct uthread) + tls_size());
+        if (mem == (char *)-1) {
+            return 0;
+        }
+        t = (struct uthread *)(mem + THREAD_STACK_SIZE);
+    }
+    tls_init((char *)(t + 1));
+    return t;
+}
+
+// 新线程的入口，clone之后在新栈上运行
+static void thread_start(void *arg) {
+    struct uthread *t = arg;
+    thread_exit(t->fn(t->arg));
+}
+
+struct uthread *thread_create(void *(*fn)(void *), void *arg) {
+    struct uthread *t = thread_alloc();
+    if (!t) {
+        return 0;
+    }
+    t->fn = fn;
+    t->arg = arg;
+    t->ret = 0;
+    t->alive = 1;
+
+    // 描述符紧挨着栈顶，描述符16字节对齐，栈顶也满足ABI要求
+    int tid = clone(thread_start, t, t, t + 1, (int *)&t->alive);
+    if (tid < 0) {
+        mutex_lock(&free_lock);
+        t->next = free_list;
+        free_list = t;
+        mutex_unlock(&free_lock);
+        return 0;
+    }
+    t->tid = tid;
+    return t;
+}
+
+void *thread_join(struct uthread *t) {
+    // alive在线程退出、不再使用自己的栈之后才被内核清零，同时futex唤醒
+    int alive;
+    while ((alive = t->alive) != 0) {
+        futex_wait(&t->alive, alive);
+    }
+    void *ret = t->ret;
+
+    mutex_lock(&free_lock);
+    t->next = free_list;
+    free_list = t;
+    mutex_unlock(&free_lock);
+    return ret;
+}
+
+void thread_exit(void *ret) {
+    thread_self()->ret = ret;
+    exit_thread(0);
+}
+
+struct uthread *thread_self(void) {
+    struct uthread *tp;
+    asm volatile("mv %0, tp" : "=r" (tp));
+    return tp - 1;
+}
+
+int thread_tid(struct uthread *t) {
+    return t->tid;
+}
+
+// 用户程序的C入口：为主线程建立TLS后调用main
+void __ulib_start(int argc, char *argv[], char *envp[]) {
+    extern int main(int argc, char *argv[], char *envp[]);
+    struct uthread *t = &main_thread;
+
+    if (tls_size() > 0) {
+        char *mem = sbrk(sizeof(struct uthread) + tls_size());
+        if (mem == (char *)-1) {
+            exit(-1);
+        }
+        t = (struct uthread *)mem;
+        tls_init((char *)(t + 1));
+    }
+    t->tid = gettid();
+    t->alive = 1;
+    asm volatile("mv tp, %0" : : "r" (t + 1));
+
+    exit(main(argc, argv, envp));
+}
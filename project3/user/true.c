@@ -0,0 +1,5 @@
+// true.c - 立即退出，用于测量创建进程的开销
+
+int main(void) {
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "ulib.h"
+#include "../include/memlayout.h"
 
 // 执行系统调用
 static inline uint64 syscall(uint64 syscall_num, uint64 a0, uint64 a1, uint64 a2, uint64 a3, uint64 a4, uint64 a5) {
@@ -21,8 +22,21 @@ static inline uint64 syscall(uint64 syscall_num, uint64 a0, uint64 a1, uint64 a2
 }
 
 // 写入系统调用
+// 控制台发送缓冲区满时内核只写入一部分并让任务阻塞，唤醒后继续写剩余部分
 int write(int fd, const void *buf, size_t count) {
-    return syscall(SYS_write, fd, (uint64)buf, count, 0, 0, 0);
+    size_t done = 0;
+
+    // count为0时也要进入内核一次（检查描述符）
+    while (1) {
+        int n = syscall(SYS_write, fd, (uint64)buf + done, count - done, 0, 0, 0);
+        if (n < 0) {
+            return done ? (int)done : n;
+        }
+        done += n;
+        if (done >= count) {
+            return (int)done;
+        }
+    }
 }
 
 // 退出系统调用
@@ -31,9 +45,10 @@ void exit(int status) {
     while(1); // 防止返回
 }
 
-// 获取进程ID系统调用
+// 获取进程ID：从vDSO进程页读取，不进入内核
 int getpid(void) {
-    return syscall(SYS_getpid, 0, 0, 0, 0, 0, 0);
+    const struct vdso_proc *vp = (const struct vdso_proc *)(USER_VDATA + 4096);
+    return vp->pid;
 }
 
 // 睡眠系统调用
@@ -46,14 +61,32 @@ void yield(void) {
     syscall(SYS_yield, 0, 0, 0, 0, 0, 0);
 }
 
-// 获取系统时间系统调用
+// 获取系统时间（毫秒）：用rdtime和vDSO时间页计算，不进入内核
+// 时间页正在更新（seq为奇数）或读取期间被更新时重读
 uint64 time(void) {
-    return syscall(SYS_time, 0, 0, 0, 0, 0, 0);
+    const struct vdso_time *vt = (const struct vdso_time *)USER_VDATA;
+    uint32 seq;
+    uint64 now, freq, offset;
+
+    do {
+        seq = vt->seq;
+        __sync_synchronize();
+        freq = vt->freq;
+        offset = vt->offset;
+        asm volatile("rdtime %0" : "=r" (now));
+        __sync_synchronize();
+    } while ((seq & 1) || seq != vt->seq);
+    return (now - offset) * 1000 / freq;
 }
 
 // 执行程序系统调用
 int exec(const char *path, char *const argv[]) {
-    return syscall(SYS_exec, (uint64)path, (uint64)argv, 0, 0, 0, 0);
+    return execve(path, argv, 0);
+}
+
+// 带环境变量的执行程序系统调用，成功时不返回
+int execve(const char *path, char *const argv[], char *const envp[]) {
+    return syscall(SYS_exec, (uint64)path, (uint64)argv, (uint64)envp, 0, 0, 0);
 }
 
 // 创建子进程系统调用
@@ -81,332 +114,189 @@ int read(int fd, void *buf, size_t count) {
     return syscall(SYS_read, fd, (uint64)buf, count, 0, 0, 0);
 }
 
-// 输出字符串
-void puts(const char *s) {
-    write(1, s, strlen(s));
+// 复制文件描述符系统调用
+int dup2(int oldfd, int newfd) {
+    return syscall(SYS_dup2, oldfd, newfd, 0, 0, 0, 0);
 }
 
-// 计算字符串长度
-size_t strlen(const char *s) {
-    size_t len = 0;
-    while(s[len] != '\0') {
-        len++;
-    }
-    return len;
+// 直接从程序文件创建子进程系统调用，fa可以为NULL
+int spawn(const char *path, char *const argv[], const spawn_file_actions_t *fa) {
+    return syscall(SYS_spawn, (uint64)path, (uint64)argv, (uint64)fa, 0, 0, 0);
 }
 
-// 将整数转换为字符串
-static char* itoa(int value, char* result, int base) {
-    // 检查base是否支持
-    if (base < 2 || base > 36) {
-        *result = '\0';
-        return result;
+void spawn_file_actions_init(spawn_file_actions_t *fa) {
+    fa->count = 0;
+}
+
+// 追加一个文件操作，已满返回-1
+static struct spawn_action *spawn_action_add(spawn_file_actions_t *fa, int type, int fd) {
+    if (fa->count >= SPAWN_MAX_ACTIONS) {
+        return 0;
     }
+    struct spawn_action *a = &fa->actions[fa->count++];
+    a->type = type;
+    a->fd = fd;
+    a->newfd = -1;
+    a->flags = 0;
+    a->path = 0;
+    return a;
+}
 
-    char* ptr = result, *ptr1 = result;
-    char tmp_char;
-    int tmp_value;
+int spawn_file_actions_addclose(spawn_file_actions_t *fa, int fd) {
+    return spawn_action_add(fa, SPAWN_FA_CLOSE, fd) ? 0 : -1;
+}
 
-    // 处理负数
-    if (value < 0 && base == 10) {
-        *ptr++ = '-';
-        value = -value;
+int spawn_file_actions_adddup2(spawn_file_actions_t *fa, int fd, int newfd) {
+    struct spawn_action *a = spawn_action_add(fa, SPAWN_FA_DUP2, fd);
+    if (!a) {
+        return -1;
     }
+    a->newfd = newfd;
+    return 0;
+}
 
-    // 处理0
-    if (value == 0) {
-        *ptr++ = '0';
-        *ptr = '\0';
-        return result;
+int spawn_file_actions_addopen(spawn_file_actions_t *fa, int fd, const char *path, int flags) {
+    struct spawn_action *a = spawn_action_add(fa, SPAWN_FA_OPEN, fd);
+    if (!a) {
+        return -1;
     }
+    a->path = path;
+    a->flags = flags;
+    return 0;
+}
 
-    // 转换整数为字符串
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
-    } while (value);
+// 创建线程系统调用：新线程共享地址空间，从fn(arg)开始在stack上运行，tp=tls
+// 线程退出时内核把*ctid清零
+int clone(void (*fn)(void *), void *arg, void *stack, void *tls, int *ctid) {
+    return syscall(SYS_clone, (uint64)fn, (uint64)arg, (uint64)stack, (uint64)tls, (uint64)ctid, 0);
+}
 
-    // 添加字符串结束符
-    *ptr-- = '\0';
+// 只退出当前线程的系统调用
+void exit_thread(int status) {
+    syscall(SYS_thread_exit, status, 0, 0, 0, 0, 0);
+    while(1); // 防止返回
+}
+
+// 获取线程ID系统调用
+int gettid(void) {
+    return syscall(SYS_gettid, 0, 0, 0, 0, 0, 0);
+}
+
+// 调整堆顶系统调用，返回原来的堆顶，失败返回(void*)-1
+void *sbrk(int64 increment) {
+    return (void *)syscall(SYS_sbrk, increment, 0, 0, 0, 0, 0);
+}
+
+// futex系统调用：*uaddr等于val时睡眠，直到被唤醒；值不相等返回-1
+int futex_wait(volatile int *uaddr, int val) {
+    return syscall(SYS_futex, (uint64)uaddr, FUTEX_WAIT, val, 0, 0, 0);
+}
+
+// futex系统调用：唤醒最多n个在uaddr上等待的线程，返回唤醒的数量
+int futex_wake(volatile int *uaddr, int n) {
+    return syscall(SYS_futex, (uint64)uaddr, FUTEX_WAKE, n, 0, 0, 0);
+}
+
+// 设置EDF调度参数系统调用（微秒），runtime为0时恢复公平调度
+int sched_setattr(uint64 runtime_us, uint64 deadline_us, uint64 period_us) {
+    return syscall(SYS_sched_setattr, runtime_us, deadline_us, period_us, 0, 0, 0);
+}
+
+// 设置亲和性系统调用：pid为0表示当前线程，mask的第i位表示允许在hart i上运行
+int sched_setaffinity(int pid, uint64 mask) {
+    return syscall(SYS_sched_setaffinity, pid, mask, 0, 0, 0, 0);
+}
+
+// 获取亲和性系统调用：返回允许运行的在线hart掩码
+int sched_getaffinity(int pid, uint64 *mask) {
+    return syscall(SYS_sched_getaffinity, pid, (uint64)mask, 0, 0, 0, 0);
+}
 
-    // 反转字符串
-    if (*result == '-') {
-        ptr1++;
+// 建立提交/完成队列共享页
+struct ring_shared *ring_setup(void) {
+    int64 va = syscall(SYS_ring_setup, 0, 0, 0, 0, 0, 0);
+    return va == -1 ? NULL : (struct ring_shared *)va;
+}
+
+// 让内核处理最多to_submit个提交项
+int ring_enter(uint32 to_submit) {
+    return syscall(SYS_ring_enter, to_submit, 0, 0, 0, 0, 0);
+}
+
+// 打开或关闭进程pid（0表示当前进程）的系统调用跟踪
+int strace_ctl(int pid, int on) {
+    return syscall(SYS_strace_ctl, pid, on, 0, 0, 0, 0);
+}
+
+// 取出最多max条跟踪记录，被覆盖的记录数写入*lost
+int strace_read(struct strace_rec *buf, int max, uint64 *lost) {
+    return syscall(SYS_strace_read, (uint64)buf, max, (uint64)lost, 0, 0, 0);
+}
+
+// 获取hart上一种中断源的延迟统计；st为NULL时由内核在控制台输出所有统计
+int irq_stat(int hart, int src, struct irq_stat *st) {
+    return syscall(SYS_irq_stat, hart, src, (uint64)st, 0, 0, 0);
+}
+
+// 设置控制台输入模式，mode为负数时只查询；返回原来的模式
+int console_mode(int mode) {
+    return syscall(SYS_console_mode, mode, 0, 0, 0, 0, 0);
+}
+
+// 设置内核日志模块（如"TRAP"、"SYSCALL"）的级别，level为负数时只查询；返回原来的级别，
+// 模块不存在返回-1。module为NULL时由内核在控制台输出所有模块的级别
+int log_level(const char *module, int level) {
+    return syscall(SYS_log_level, (uint64)module, level, 0, 0, 0, 0);
+}
+
+// 获取系统调用统计：调用次数、累计cycle数和log2延迟直方图
+int syscall_stat(int num, struct syscall_stat *st) {
+    return syscall(SYS_syscall_stat, num, (uint64)st, 0, 0, 0, 0);
+}
+
+// 获取调度统计系统调用
+int sched_getstat(struct sched_stat *st) {
+    return syscall(SYS_sched_getstat, (uint64)st, 0, 0, 0, 0, 0);
+}
+
+// 输出字符串
+void puts(const char *s) {
+    write(1, s, strlen(s));
+}
+
+// 计算字符串长度
+size_t strlen(const char *s) {
+    size_t len = 0;
+    while(s[len] != '\0') {
+        len++;
     }
-    while (ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr-- = *ptr1;
-        *ptr1++ = tmp_char;
+    return len;
+}
+
+// 比较字符串
+int strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
     }
+    return (unsigned char)*a - (unsigned char)*b;
+}
 
-    return result;
+// 格式化缓冲区满时写到标准输出
+static void printf_flush(struct printbuf *pb) {
+    write(1, pb->buf, pb->len);
+    pb->len = 0;
 }
 
-// 格式化输出
+// 格式化输出：整条消息在用户态格式化到缓冲区，通常只需要一次write
 int printf(const char *fmt, ...) {
-    char c;
-    int count = 0;
-    char buf[24];
+    char buf[256];
+    struct printbuf pb = PRINTBUF_INIT(buf, sizeof(buf), printf_flush, NULL);
     va_list args;
-    
+    int count;
+
     va_start(args, fmt);
-    
-    // 创建一个缓冲区来收集普通字符
-    char output_buf[256];
-    int buf_index = 0;
-    
-    while ((c = *fmt++)) {
-        if (c != '%') {
-            // 将普通字符添加到缓冲区
-            output_buf[buf_index++] = c;
-            count++;
-            
-            // 如果缓冲区快满了，先输出
-            if (buf_index >= 255) {
-                write(1, output_buf, buf_index);
-                buf_index = 0;
-            }
-            continue;
-        }
-        
-        // 遇到格式说明符，先输出之前收集的普通字符
-        if (buf_index > 0) {
-            write(1, output_buf, buf_index);
-            buf_index = 0;
-        }
-        
-        // 处理格式说明符
-        c = *fmt++;
-        if (!c) break;
-        
-        // 处理宽度和填充
-        int width = 0;
-        int zero_padding = 0;
-        
-        if (c == '0') {
-            zero_padding = 1;
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        // 解析宽度
-        while (c >= '0' && c <= '9') {
-            width = width * 10 + (c - '0');
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        // 检查长整数标志
-        int is_long = 0;
-        if (c == 'l') {
-            is_long = 1;
-            c = *fmt++;
-            if (!c) break;
-        }
-        
-        switch (c) {
-            case 'c': {
-                // 字符
-                char ch = (char)va_arg(args, int);
-                char tmp[2] = {ch, '\0'};
-                write(1, tmp, 1);
-                count++;
-                break;
-            }
-            
-            case 's': {
-                // 字符串
-                char* s = va_arg(args, char*);
-                if (!s) s = "(null)";
-                int len = strlen(s);
-                
-                // 处理宽度填充
-                if (width > len && !zero_padding) {
-                    char space = ' ';
-                    for (int i = 0; i < width - len; i++) {
-                        write(1, &space, 1);
-                        count++;
-                    }
-                }
-                
-                write(1, s, len);
-                count += len;
-                break;
-            }
-            
-            case 'd': {
-                // 有符号十进制整数
-                if (is_long) {
-                    long value = va_arg(args, long);
-                    if (value < 0) {
-                        write(1, "-", 1);
-                        count++;
-                        value = -value;
-                    }
-                    // 使用无符号长整型转换
-                    char num_buf[24];
-                    int i = 0;
-                    unsigned long uvalue = (unsigned long)value;
-                    do {
-                        num_buf[i++] = '0' + (uvalue % 10);
-                        uvalue /= 10;
-                    } while (uvalue > 0);
-                    
-                    // 处理零填充
-                    if (width > i && zero_padding) {
-                        char zero = '0';
-                        for (int j = 0; j < width - i; j++) {
-                            write(1, &zero, 1);
-                            count++;
-                        }
-                    }
-                    
-                    // 反向输出数字
-                    while (i > 0) {
-                        i--;
-                        write(1, &num_buf[i], 1);
-                        count++;
-                    }
-                } else {
-                    int value = va_arg(args, int);
-                    itoa(value, buf, 10);
-                    int len = strlen(buf);
-                    
-                    // 处理零填充
-                    if (width > len && zero_padding) {
-                        char zero = '0';
-                        for (int i = 0; i < width - len; i++) {
-                            write(1, &zero, 1);
-                            count++;
-                        }
-                    }
-                    
-                    write(1, buf, len);
-                    count += len;
-                }
-                break;
-            }
-            
-            case 'x': {
-                // 十六进制整数
-                if (is_long) {
-                    unsigned long value = va_arg(args, unsigned long);
-                    char num_buf[24];
-                    int i = 0;
-                    do {
-                        int digit = value % 16;
-                        num_buf[i++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
-                        value /= 16;
-                    } while (value > 0);
-                    
-                    // 处理零填充
-                    if (width > i && zero_padding) {
-                        char zero = '0';
-                        for (int j = 0; j < width - i; j++) {
-                            write(1, &zero, 1);
-                            count++;
-                        }
-                    }
-                    
-                    // 反向输出数字
-                    while (i > 0) {
-                        i--;
-                        write(1, &num_buf[i], 1);
-                        count++;
-                    }
-                } else {
-                    unsigned int value = va_arg(args, unsigned int);
-                    itoa(value, buf, 16);
-                    int len = strlen(buf);
-                    
-                    // 处理零填充
-                    if (width > len && zero_padding) {
-                        char zero = '0';
-                        for (int i = 0; i < width - len; i++) {
-                            write(1, &zero, 1);
-                            count++;
-                        }
-                    }
-                    
-                    write(1, buf, len);
-                    count += len;
-                }
-                break;
-            }
-            
-            case 'p': {
-                // 指针（十六进制）
-                unsigned long value = (unsigned long)va_arg(args, void*);
-                write(1, "0x", 2);
-                
-                char num_buf[24];
-                int i = 0;
-                do {
-                    int digit = value % 16;
-                    num_buf[i++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
-                    value /= 16;
-                } while (value > 0);
-                
-                // 处理零填充
-                if (width > i && zero_padding) {
-                    char zero = '0';
-                    for (int j = 0; j < width - i; j++) {
-                        write(1, &zero, 1);
-                        count++;
-                    }
-                }
-                
-                // 反向输出数字
-                while (i > 0) {
-                    i--;
-                    write(1, &num_buf[i], 1);
-                    count++;
-                }
-                count += 2; // 为"0x"前缀
-                break;
-            }
-            
-            case '%': {
-                // 百分号
-                write(1, "%", 1);
-                count++;
-                break;
-            }
-            
-            default: {
-                // 未知格式，输出原样
-                char tmp[4] = {'%', 0, 0, 0};
-                int tmp_len = 1;
-                
-                if (zero_padding) {
-                    tmp[tmp_len++] = '0';
-                }
-                
-                if (width > 0) {
-                    char width_buf[8];
-                    itoa(width, width_buf, 10);
-                    write(1, width_buf, strlen(width_buf));
-                    count += strlen(width_buf);
-                }
-                
-                if (is_long) {
-                    tmp[tmp_len++] = 'l';
-                }
-                
-                tmp[tmp_len++] = c;
-                write(1, tmp, tmp_len);
-                count += tmp_len;
-                break;
-            }
-        }
-    }
-    
-    // 输出剩余的普通字符
-    if (buf_index > 0) {
-        write(1, output_buf, buf_index);
-    }
-    
+    count = vbprintf(&pb, fmt, args);
     va_end(args);
     return count;
 }
\ No newline at end of file
@@ -2,20 +2,148 @@
 #define _ULIB_H_
 
 #include "../include/types.h"
+#include "../include/printf.h"
 
-// 系统调用号 - 与内核定义匹配
-#define SYS_write      1
-#define SYS_exit       2
-#define SYS_getpid     3
-#define SYS_sleep      4
-#define SYS_yield      5
-#define SYS_time       6
-#define SYS_exec       7
-#define SYS_fork       8
-#define SYS_wait       9
-#define SYS_open       10
-#define SYS_close      11
-#define SYS_read       12
+// 系统调用号 - 与内核共用同一张表
+enum {
+#define SYSCALL(num, name) SYS_##name = num,
+#include "../include/syscall_list.h"
+#undef SYSCALL
+    NSYSCALL
+};
+
+// 系统调用统计 - 与内核struct syscall_stat布局一致
+#define SYSCALL_HIST_BUCKETS 32
+
+struct syscall_stat {
+    uint64 count;
+    uint64 cycles;
+    uint64 hist[SYSCALL_HIST_BUCKETS];
+};
+
+// 调度类
+#define SCHED_CLASS_IDLE 0
+#define SCHED_CLASS_FAIR 1
+#define SCHED_CLASS_EDF  2
+
+// 调度统计 - 与内核struct sched_stat布局一致
+struct sched_stat {
+    uint64 policy;          // 调度类
+    uint64 nr_jobs;         // EDF已完成作业数
+    uint64 nr_misses;       // EDF错过截止时间次数
+    uint64 total_misses;    // 系统内所有EDF任务的错过次数
+    uint64 sum_exec_us;     // 累计运行时间（微秒）
+    uint64 total_bw;        // 已准入的EDF总带宽（千分比）
+    uint64 cpu;             // 当前运行的hart
+    uint64 nr_migrations;   // 被迁移到其他hart的次数
+    uint64 fpu_saves;       // 切换时保存浮点寄存器的次数
+    uint64 fpu_restores;    // 使用浮点时加载浮点寄存器的次数
+};
+
+// 提交/完成队列 - 与内核ring.h布局一致
+#define RING_ENTRIES 64
+
+#define RING_OP_NOP   0
+#define RING_OP_WRITE 1
+#define RING_OP_READ  2
+#define RING_OP_OPEN  3
+#define RING_OP_CLOSE 4
+#define RING_OP_SLEEP 5
+
+struct ring_sqe {
+    uint32 op;
+    int fd;
+    uint64 addr;
+    uint64 len;
+    uint64 user_data;
+};
+
+struct ring_cqe {
+    uint64 user_data;
+    int64 res;
+};
+
+struct ring_shared {
+    volatile uint32 sq_head;
+    volatile uint32 sq_tail;
+    volatile uint32 cq_head;
+    volatile uint32 cq_tail;
+    struct ring_sqe sqes[RING_ENTRIES];
+    struct ring_cqe cqes[RING_ENTRIES];
+};
+
+// vDSO数据页 - 与内核vdso.h布局一致，映射在USER_VDATA（memlayout.h）
+struct vdso_time {
+    volatile uint32 seq;
+    uint32 pad;
+    volatile uint64 freq;
+    volatile uint64 offset;
+};
+
+struct vdso_proc {
+    uint64 pid;
+};
+
+// 系统调用跟踪记录 - 与内核strace.h布局一致
+struct strace_rec {
+    uint64 enter;
+    uint64 exit;
+    uint32 pid;
+    uint16 num;
+    uint16 cpu;
+    uint64 args[6];
+    uint64 ret;
+};
+
+// 中断延迟统计 - 与内核irqstat.h布局一致，单位是timebase tick
+#define IRQ_HIST_BUCKETS 16
+#define IRQ_SRC_TIMER    0
+#define IRQ_SRC_EXTERNAL 1
+
+struct irq_stat {
+    uint64 count;
+    uint64 entry_sum;
+    uint64 entry_max;
+    uint64 exit_sum;
+    uint64 exit_max;
+    uint64 entry_hist[IRQ_HIST_BUCKETS];
+    uint64 exit_hist[IRQ_HIST_BUCKETS];
+};
+
+// 控制台输入模式：规范模式按行读取并回显，原始模式逐字节读取
+#define CONSOLE_CANON 0
+#define CONSOLE_RAW   1
+
+// 内核日志级别（与console.h一致）
+#define LOG_OFF   0
+#define LOG_INFO  1
+#define LOG_DEBUG 2
+
+// futex操作
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+// open的flags
+#define O_RDONLY 0
+
+// spawn的文件操作 - 与内核struct spawn_file_actions布局一致
+#define SPAWN_MAX_ACTIONS 8
+#define SPAWN_FA_CLOSE 1
+#define SPAWN_FA_DUP2  2
+#define SPAWN_FA_OPEN  3
+
+struct spawn_action {
+    int type;
+    int fd;
+    int newfd;
+    int flags;
+    const char *path;
+};
+
+typedef struct {
+    int count;
+    struct spawn_action actions[SPAWN_MAX_ACTIONS];
+} spawn_file_actions_t;
 
 // 系统调用函数声明
 int write(int fd, const void *buf, size_t count);
@@ -25,15 +153,94 @@ void sleep(uint64 milliseconds);
 void yield(void);
 uint64 time(void);
 int exec(const char *path, char *const argv[]);
+int execve(const char *path, char *const argv[], char *const envp[]);
 int fork(void);
 int wait(int *status);
 int open(const char *path, int flags);
 int close(int fd);
 int read(int fd, void *buf, size_t count);
+int dup2(int oldfd, int newfd);
+int spawn(const char *path, char *const argv[], const spawn_file_actions_t *fa);
+int sched_setattr(uint64 runtime_us, uint64 deadline_us, uint64 period_us);
+int sched_getstat(struct sched_stat *st);
+int sched_setaffinity(int pid, uint64 mask);
+int sched_getaffinity(int pid, uint64 *mask);
+int clone(void (*fn)(void *), void *arg, void *stack, void *tls, int *ctid);
+void exit_thread(int status) __attribute__((noreturn));
+int gettid(void);
+void *sbrk(int64 increment);
+int futex_wait(volatile int *uaddr, int val);
+int futex_wake(volatile int *uaddr, int n);
+int syscall_stat(int num, struct syscall_stat *st);
+struct ring_shared *ring_setup(void);
+int ring_enter(uint32 to_submit);
+int strace_ctl(int pid, int on);
+int strace_read(struct strace_rec *buf, int max, uint64 *lost);
+int irq_stat(int hart, int src, struct irq_stat *st);
+int console_mode(int mode);
+int log_level(const char *module, int level);
+
+// spawn文件操作
+void spawn_file_actions_init(spawn_file_actions_t *fa);
+int spawn_file_actions_addclose(spawn_file_actions_t *fa, int fd);
+int spawn_file_actions_adddup2(spawn_file_actions_t *fa, int fd, int newfd);
+int spawn_file_actions_addopen(spawn_file_actions_t *fa, int fd, const char *path, int flags);
+
+// 提交/完成队列（ring.c），一个进程只有一个队列，提交和取结果需要由同一个线程进行
+// 放入一个提交项，队列已满返回-1
+int ring_prep(struct ring_shared *r, uint32 op, int fd, uint64 addr, uint64 len, uint64 user_data);
+// 已放入但内核还没有处理的提交项数量
+uint32 ring_pending(struct ring_shared *r);
+// 取出一个完成项，没有时返回-1
+int ring_reap(struct ring_shared *r, struct ring_cqe *cqe);
+// 提交所有待处理项，返回内核处理的数量
+int ring_submit(struct ring_shared *r);
+
+// 线程（thread.c）
+// 每个线程有独立的栈和TLS块（__thread变量），tp指向TLS块起点
+struct uthread;
+struct uthread *thread_create(void *(*fn)(void *), void *arg);
+void *thread_join(struct uthread *t);
+void thread_exit(void *ret) __attribute__((noreturn));
+struct uthread *thread_self(void);
+int thread_tid(struct uthread *t);
+
+// 同步原语（sync.c），无竞争时不进入内核
+// 互斥锁：0未加锁，1已加锁，2已加锁且可能有等待者
+typedef struct {
+    volatile int state;
+} mutex_t;
+
+// 条件变量：每次signal/broadcast序号加一，等待者在序号上futex_wait
+typedef struct {
+    volatile int seq;
+} cond_t;
+
+// 信号量
+typedef struct {
+    volatile int count;
+    volatile int waiters;
+} sem_t;
+
+#define MUTEX_INITIALIZER { 0 }
+#define COND_INITIALIZER  { 0 }
+
+void mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+int mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+void cond_init(cond_t *c);
+void cond_wait(cond_t *c, mutex_t *m);
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
+void sem_init(sem_t *s, int value);
+void sem_wait(sem_t *s);
+void sem_post(sem_t *s);
 
 // 库函数声明
 void puts(const char *s);
 size_t strlen(const char *s);
+int strcmp(const char *a, const char *b);
 int printf(const char *fmt, ...);
 
 #endif // _ULIB_H_
\ No newline at end of file
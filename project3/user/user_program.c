@@ -1,5 +1,1037 @@
 #include "ulib.h"
-int main() {
+
+// EDF周期任务测试参数
+#define EDF_RUNTIME_US  20000   // 每周期执行预算20ms
+#define EDF_PERIOD_US   100000  // 周期（同时也是相对截止时间）100ms
+#define EDF_JOBS        20      // 运行的作业数
+
+// 模拟一个作业的计算量，远小于执行预算
+static void edf_job(void) {
+    for (volatile int i = 0; i < 20000; i++);
+}
+
+// EDF测试：准入范围内的周期任务不应错过截止时间
+static void edf_test(void) {
+    struct sched_stat st;
+
+    // 准入控制：带宽为100%的申请超过上限，必须被拒绝
+    if (sched_setattr(EDF_PERIOD_US, EDF_PERIOD_US, EDF_PERIOD_US) == 0) {
+        printf("EDF测试失败: 超额带宽被准入\n");
+        sched_setattr(0, 0, 0);
+        return;
+    }
+
+    if (sched_setattr(EDF_RUNTIME_US, EDF_PERIOD_US, EDF_PERIOD_US) != 0) {
+        printf("EDF测试失败: 准入被拒绝\n");
+        return;
+    }
+
+    // 每个作业完成后yield，睡眠到下一个周期释放
+    for (int i = 0; i < EDF_JOBS; i++) {
+        edf_job();
+        yield();
+    }
+
+    sched_getstat(&st);
+    sched_setattr(0, 0, 0);
+
+    printf("EDF测试: 作业数=%ld, 错过截止时间=%ld, 系统总错过=%ld\n",
+           st.nr_jobs, st.nr_misses, st.total_misses);
+    if (st.nr_misses == 0 && st.nr_jobs == EDF_JOBS) {
+        printf("EDF测试通过\n");
+    } else {
+        printf("EDF测试失败\n");
+    }
+}
+
+// 多任务EDF测试：所有任务绑定到同一个hart，才能比较它们之间的先后
+static int edf_hart;
+static volatile int edf_stop;
+static volatile int edf_admitted;
+static volatile uint64 edf_short_jobs;
+static volatile uint64 edf_fair_loops;
+
+// 多任务测试中各线程的结果
+struct edf_result {
+    struct sched_stat st;
+    int ok;                 // 准入成功，且作业期间观察到了预期的抢占
+};
+
+// 消耗us微秒的CPU时间，按本任务的累计运行时间计算，被抢占的时间不算
+static void edf_spin_us(uint64 us) {
+    struct sched_stat st;
+
+    sched_getstat(&st);
+    uint64 end = st.sum_exec_us + us;
+    do {
+        sched_getstat(&st);
+    } while (st.sum_exec_us < end);
+}
+
+// 绑定到edf_hart，yield之后就在那个hart上运行
+static void edf_pin(void) {
+    sched_setaffinity(0, 1ULL << edf_hart);
+    yield();
+}
+
+// 短截止时间任务：3ms/10ms，每个作业1ms，直到长任务结束
+static void *edf_short_worker(void *arg) {
+    struct edf_result *r = arg;
+
+    edf_pin();
+    if (sched_setattr(3000, 10000, 10000) != 0) {
+        edf_stop = 1;
+        return 0;
+    }
+    r->ok = 1;
+    edf_admitted = 1;
+    while (!edf_stop) {
+        edf_spin_us(1000);
+        edf_short_jobs++;
+        yield();
+    }
+    sched_getstat(&r->st);
+    sched_setattr(0, 0, 0);
+    return 0;
+}
+
+// 长截止时间任务：25ms/50ms，每个作业15ms，比短任务的周期还长。
+// 只有截止时间更早的短任务抢占它，短任务才不会错过截止时间；每个作业期间短任务都应完成作业
+static void *edf_long_worker(void *arg) {
+    struct edf_result *r = arg;
+
+    // 短任务进入EDF之后才开始，否则第一个作业期间短任务还是公平任务，无法抢占
+    edf_pin();
+    while (!edf_admitted && !edf_stop) {
+        yield();
+    }
+    if (edf_stop || sched_setattr(25000, 50000, 50000) != 0) {
+        edf_stop = 1;
+        return 0;
+    }
+    r->ok = 1;
+    for (int i = 0; i < 6 && !edf_stop; i++) {
+        uint64 before = edf_short_jobs;
+        edf_spin_us(15000);
+        if (edf_short_jobs == before) {
+            r->ok = 0;
+        }
+        yield();
+    }
+    sched_getstat(&r->st);
+    sched_setattr(0, 0, 0);
+    edf_stop = 1;
+    return 0;
+}
+
+// 两个EDF任务按截止时间排序
+static void edf_order_test(void) {
+    struct edf_result s = { 0 }, l = { 0 };
+
+    edf_stop = 0;
+    edf_admitted = 0;
+    edf_short_jobs = 0;
+    struct uthread *ts = thread_create(edf_short_worker, &s);
+    struct uthread *tl = thread_create(edf_long_worker, &l);
+    if (!ts || !tl) {
+        printf("EDF排序测试失败: thread_create失败\n");
+        edf_stop = 1;
+        return;
+    }
+    thread_join(tl);
+    thread_join(ts);
+
+    printf("EDF排序测试: 短任务 作业=%ld 错过=%ld, 长任务 作业=%ld 错过=%ld\n",
+           s.st.nr_jobs, s.st.nr_misses, l.st.nr_jobs, l.st.nr_misses);
+    if (s.ok && l.ok && l.st.nr_jobs == 6 && s.st.nr_misses == 0 && l.st.nr_misses == 0) {
+        printf("EDF排序测试通过\n");
+    } else {
+        printf("EDF排序测试失败\n");
+    }
+}
+
+// 与EDF任务在同一hart上的CPU密集公平任务
+static void *edf_fair_worker(void *arg) {
+    edf_pin();
+    while (!edf_stop) {
+        edf_fair_loops++;
+    }
+    return 0;
+}
+
+// EDF任务：5ms/20ms，每个作业2ms，与一直运行的公平任务竞争
+static void *edf_rt_worker(void *arg) {
+    struct edf_result *r = arg;
+
+    edf_pin();
+    if (sched_setattr(5000, 20000, 20000) != 0) {
+        edf_stop = 1;
+        return 0;
+    }
+    r->ok = 1;
+    for (int i = 0; i < 15; i++) {
+        edf_spin_us(2000);
+        yield();
+    }
+    sched_getstat(&r->st);
+    sched_setattr(0, 0, 0);
+    edf_stop = 1;
+    return 0;
+}
+
+// EDF任务抢占公平任务：公平任务一直可以运行，EDF任务仍不应错过截止时间
+static void edf_fair_test(void) {
+    struct edf_result r = { 0 };
+
+    edf_stop = 0;
+    edf_fair_loops = 0;
+    struct uthread *tf = thread_create(edf_fair_worker, 0);
+    struct uthread *te = thread_create(edf_rt_worker, &r);
+    if (!tf || !te) {
+        printf("EDF抢占测试失败: thread_create失败\n");
+        edf_stop = 1;
+        return;
+    }
+    thread_join(te);
+    thread_join(tf);
+
+    printf("EDF抢占测试: 作业=%ld 错过=%ld, 公平任务循环=%ld\n",
+           r.st.nr_jobs, r.st.nr_misses, edf_fair_loops);
+    if (r.ok && r.st.nr_jobs == 15 && r.st.nr_misses == 0 && edf_fair_loops > 0) {
+        printf("EDF抢占测试通过\n");
+    } else {
+        printf("EDF抢占测试失败\n");
+    }
+}
+
+// 占用60%带宽，直到准入测试结束
+static void *edf_hog_worker(void *arg) {
+    if (sched_setattr(6000, 10000, 10000) != 0) {
+        edf_admitted = -1;
+        return 0;
+    }
+    edf_admitted = 1;
+    while (!edf_stop) {
+        yield();
+    }
+    sched_setattr(0, 0, 0);
+    return 0;
+}
+
+// 准入控制：已准入的带宽加上新的申请超过95%时拒绝，参数过大时不能因溢出被准入
+static void edf_admission_test(void) {
+    int over, huge;
+
+    edf_stop = 0;
+    edf_admitted = 0;
+    struct uthread *t = thread_create(edf_hog_worker, 0);
+    if (!t) {
+        printf("EDF准入测试失败: thread_create失败\n");
+        return;
+    }
+    while (!edf_admitted) {
+        yield();
+    }
+    over = sched_setattr(4000, 10000, 10000);
+    huge = sched_setattr(1ULL << 44, 1ULL << 44, 1ULL << 44);
+    if (over == 0 || huge == 0) {
+        sched_setattr(0, 0, 0);
+    }
+    edf_stop = 1;
+    thread_join(t);
+
+    if (edf_admitted == 1 && over == -1 && huge == -1) {
+        printf("EDF准入测试通过\n");
+    } else {
+        printf("EDF准入测试失败: 占用线程=%d, 超额申请=%d, 溢出申请=%d\n", edf_admitted, over, huge);
+    }
+}
+
+// 多任务EDF测试，在默认亲和性掩码中编号最大的hart上运行
+static void edf_multi_test(void) {
+    uint64 mask;
+
+    if (sched_getaffinity(0, &mask) < 0 || mask == 0) {
+        printf("EDF测试失败: 无法取得亲和性掩码\n");
+        return;
+    }
+    edf_hart = 63;
+    while (!((mask >> edf_hart) & 1)) {
+        edf_hart--;
+    }
+    edf_order_test();
+    edf_fair_test();
+    edf_admission_test();
+}
+
+// 进程创建基准测试的次数
+#define SPAWN_BENCH_N   50
+
+// spawn测试：文件操作把/motd重定向为cat的标准输入
+static void spawn_test(void) {
+    char *argv[] = { "cat", 0 };
+    spawn_file_actions_t fa;
+    int status = -1;
+
+    spawn_file_actions_init(&fa);
+    spawn_file_actions_addopen(&fa, 0, "/motd", O_RDONLY);
+    int pid = spawn("/cat", argv, &fa);
+    if (pid < 0 || wait(&status) != pid || status != 0) {
+        printf("spawn测试失败: pid=%d, status=%d\n", pid, status);
+        return;
+    }
+    printf("spawn测试通过\n");
+}
+
+// 比较spawn与fork+exec启动短命程序的开销
+static void spawn_bench(void) {
+    char *argv[] = { "true", 0 };
+    uint64 start, spawn_ms, fork_ms;
+
+    start = time();
+    for (int i = 0; i < SPAWN_BENCH_N; i++) {
+        if (spawn("/true", argv, 0) < 0 || wait(0) < 0) {
+            printf("spawn基准测试失败\n");
+            return;
+        }
+    }
+    spawn_ms = time() - start;
+
+    start = time();
+    for (int i = 0; i < SPAWN_BENCH_N; i++) {
+        int pid = fork();
+        if (pid == 0) {
+            exec("/true", argv);
+            exit(127);
+        }
+        if (pid < 0 || wait(0) < 0) {
+            printf("fork+exec基准测试失败\n");
+            return;
+        }
+    }
+    fork_ms = time() - start;
+
+    printf("启动%d个进程: spawn %ld ms (平均 %ld us), fork+exec %ld ms (平均 %ld us)\n",
+           SPAWN_BENCH_N, spawn_ms, spawn_ms * 1000 / SPAWN_BENCH_N,
+           fork_ms, fork_ms * 1000 / SPAWN_BENCH_N);
+}
+
+// 线程测试参数
+#define THREAD_N        4           // 线程数，与默认hart数相同
+#define THREAD_WORK     20000000UL  // 并行测试的总计算量
+
+// 每个线程独立的TLS变量
+static __thread int tls_counter = 100;
+static __thread int tls_zero;
+
+// 每个线程累加自己的TLS变量，返回最终值
+static void *tls_worker(void *arg) {
+    int n = (int)(uint64)arg;
+
+    for (int i = 0; i < n; i++) {
+        tls_counter++;
+        tls_zero += 2;
+        yield();
+    }
+    return (void *)(uint64)(tls_counter + tls_zero);
+}
+
+// 纯计算负载，arg为迭代次数
+static void *spin_worker(void *arg) {
+    uint64 n = (uint64)arg;
+    volatile uint64 x = 0;
+
+    for (uint64 i = 0; i < n; i++) {
+        x += i;
+    }
+    return 0;
+}
+
+// 线程测试：各线程的__thread变量互不影响，join取回返回值
+static void thread_test(void) {
+    struct uthread *t[THREAD_N];
+
+    for (int i = 0; i < THREAD_N; i++) {
+        t[i] = thread_create(tls_worker, (void *)(uint64)(i + 1));
+        if (!t[i]) {
+            printf("thread_create失败\n");
+            return;
+        }
+    }
+    for (int i = 0; i < THREAD_N; i++) {
+        int n = i + 1;
+        int ret = (int)(uint64)thread_join(t[i]);
+        if (ret != 100 + n + 2 * n) {
+            printf("线程测试失败: 线程%d返回%d\n", i, ret);
+            return;
+        }
+    }
+    if (tls_counter != 100 || tls_zero != 0) {
+        printf("线程测试失败: 主线程TLS被修改\n");
+        return;
+    }
+    printf("线程测试通过: pid=%d, 主线程tid=%d\n", getpid(), thread_tid(thread_self()));
+}
+
+// 比较单线程与THREAD_N个线程完成相同计算量的时间
+static void thread_bench(void) {
+    struct uthread *t[THREAD_N];
+    uint64 start, one_ms, all_ms;
+
+    start = time();
+    spin_worker((void *)THREAD_WORK);
+    one_ms = time() - start;
+
+    start = time();
+    for (int i = 0; i < THREAD_N; i++) {
+        t[i] = thread_create(spin_worker, (void *)(THREAD_WORK / THREAD_N));
+        if (!t[i]) {
+            printf("线程基准测试失败\n");
+            return;
+        }
+    }
+    for (int i = 0; i < THREAD_N; i++) {
+        thread_join(t[i]);
+    }
+    all_ms = time() - start;
+
+    printf("计算负载: 单线程 %ld ms, %d个线程 %ld ms\n", one_ms, THREAD_N, all_ms);
+}
+
+// 同步原语测试参数
+#define LOCK_BENCH_N    1000000     // 无竞争加解锁次数
+#define LOCK_INCS       50000       // 有竞争时每个线程的加锁次数
+#define PC_ITEMS        1000        // 生产者/消费者传递的数据个数
+#define PC_SLOTS        4           // 缓冲区大小
+#define PINGPONG_ROUNDS 200         // 条件变量往返次数
+
+static mutex_t bench_mutex = MUTEX_INITIALIZER;
+static volatile int bench_spin;
+static volatile uint64 bench_counter;
+
+// 对照组：自旋等待期间yield的锁
+static void *spin_incr(void *arg) {
+    for (int i = 0; i < LOCK_INCS; i++) {
+        while (__sync_lock_test_and_set(&bench_spin, 1)) {
+            yield();
+        }
+        bench_counter++;
+        __sync_lock_release(&bench_spin);
+    }
+    return 0;
+}
+
+static void *mutex_incr(void *arg) {
+    for (int i = 0; i < LOCK_INCS; i++) {
+        mutex_lock(&bench_mutex);
+        bench_counter++;
+        mutex_unlock(&bench_mutex);
+    }
+    return 0;
+}
+
+// THREAD_N个线程同时执行fn，返回耗时（毫秒），计数不正确返回-1
+static int64 contended_run(void *(*fn)(void *)) {
+    struct uthread *t[THREAD_N];
+    uint64 start = time();
+
+    bench_counter = 0;
+    for (int i = 0; i < THREAD_N; i++) {
+        t[i] = thread_create(fn, 0);
+        if (!t[i]) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < THREAD_N; i++) {
+        thread_join(t[i]);
+    }
+    if (bench_counter != (uint64)THREAD_N * LOCK_INCS) {
+        return -1;
+    }
+    return time() - start;
+}
+
+// 加锁吞吐量：无竞争的快速路径，以及THREAD_N个线程竞争同一把锁
+static void lock_bench(void) {
+    uint64 start = time();
+    for (int i = 0; i < LOCK_BENCH_N; i++) {
+        mutex_lock(&bench_mutex);
+        mutex_unlock(&bench_mutex);
+    }
+    uint64 uncontended_ms = time() - start;
+
+    int64 mutex_ms = contended_run(mutex_incr);
+    int64 spin_ms = contended_run(spin_incr);
+    if (mutex_ms < 0 || spin_ms < 0) {
+        printf("加锁基准测试失败\n");
+        return;
+    }
+    printf("无竞争: %d次加解锁 %ld ms\n", LOCK_BENCH_N, uncontended_ms);
+    printf("%d个线程竞争, 共%d次加锁: futex互斥锁 %ld ms, yield自旋锁 %ld ms\n",
+           THREAD_N, THREAD_N * LOCK_INCS, mutex_ms, spin_ms);
+}
+
+// 信号量实现的有界缓冲区
+static int pc_buf[PC_SLOTS];
+static int pc_head, pc_tail;
+static sem_t pc_empty, pc_full;
+static mutex_t pc_lock = MUTEX_INITIALIZER;
+
+static void *producer(void *arg) {
+    for (int i = 1; i <= PC_ITEMS; i++) {
+        sem_wait(&pc_empty);
+        mutex_lock(&pc_lock);
+        pc_buf[pc_head++ % PC_SLOTS] = i;
+        mutex_unlock(&pc_lock);
+        sem_post(&pc_full);
+    }
+    return 0;
+}
+
+static void *consumer(void *arg) {
+    uint64 sum = 0;
+    for (int i = 0; i < PC_ITEMS; i++) {
+        sem_wait(&pc_full);
+        mutex_lock(&pc_lock);
+        sum += pc_buf[pc_tail++ % PC_SLOTS];
+        mutex_unlock(&pc_lock);
+        sem_post(&pc_empty);
+    }
+    return (void *)sum;
+}
+
+// 条件变量实现的两线程交替
+static mutex_t pp_lock = MUTEX_INITIALIZER;
+static cond_t pp_cond = COND_INITIALIZER;
+static int pp_turn;
+
+static void *pingpong(void *arg) {
+    int me = (int)(uint64)arg;
+    for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+        mutex_lock(&pp_lock);
+        while (pp_turn != me) {
+            cond_wait(&pp_cond, &pp_lock);
+        }
+        pp_turn = !me;
+        cond_broadcast(&pp_cond);
+        mutex_unlock(&pp_lock);
+    }
+    return 0;
+}
+
+// 同步原语测试：信号量生产者/消费者，条件变量交替执行
+static void sync_test(void) {
+    sem_init(&pc_empty, PC_SLOTS);
+    sem_init(&pc_full, 0);
+    struct uthread *p = thread_create(producer, 0);
+    struct uthread *c = thread_create(consumer, 0);
+    if (!p || !c) {
+        printf("同步测试失败: 无法创建线程\n");
+        return;
+    }
+    thread_join(p);
+    uint64 sum = (uint64)thread_join(c);
+    if (sum != (uint64)PC_ITEMS * (PC_ITEMS + 1) / 2) {
+        printf("信号量测试失败: sum=%ld\n", sum);
+        return;
+    }
+
+    struct uthread *a = thread_create(pingpong, (void *)0);
+    struct uthread *b = thread_create(pingpong, (void *)1);
+    if (!a || !b) {
+        printf("同步测试失败: 无法创建线程\n");
+        return;
+    }
+    thread_join(a);
+    thread_join(b);
+    printf("同步测试通过: 信号量传递%d个数据, 条件变量往返%d次\n", PC_ITEMS, PINGPONG_ROUNDS);
+}
+
+// 亲和性测试参数
+#define JITTER_MS       100         // 测量抖动的时长
+#define TIMEBASE_MHZ    10          // QEMU virt的time寄存器频率
+
+static inline uint64 rdtime(void) {
+    uint64 t;
+    asm volatile("rdtime %0" : "=r" (t));
+    return t;
+}
+
+// 在当前hart上忙循环，返回相邻两次读取time之间的最大间隔（微秒），
+// 间隔来自时钟中断和其他打断
+static uint64 measure_jitter(void) {
+    uint64 end = rdtime() + JITTER_MS * 1000 * TIMEBASE_MHZ;
+    uint64 last = rdtime(), max = 0;
+
+    while (last < end) {
+        uint64 now = rdtime();
+        if (now - last > max) {
+            max = now - last;
+        }
+        last = now;
+    }
+    return max / TIMEBASE_MHZ;
+}
+
+// 系统调用往返开销：gettid和write都走快速路径，不需要完整的trap帧
+#define ECALL_ROUNDS    10000
+
+static inline uint64 rdcycle(void) {
+    uint64 c;
+    asm volatile("rdcycle %0" : "=r" (c));
+    return c;
+}
+
+static void timed_round(const char *name, int (*fn)(void)) {
+    uint64 start, cycles, ticks;
+
+    fn();
+    start = rdtime();
+    cycles = rdcycle();
+    for (int i = 0; i < ECALL_ROUNDS; i++) {
+        fn();
+    }
+    cycles = rdcycle() - cycles;
+    ticks = rdtime() - start;
+    printf("%s: %ld cycles/次, %ld ns/次\n",
+           name, cycles / ECALL_ROUNDS, ticks * 1000 / TIMEBASE_MHZ / ECALL_ROUNDS);
+}
+
+static int empty_write(void) {
+    return write(1, "", 0);
+}
+
+static void ecall_bench(void) {
+    timed_round("ecall往返(gettid)", gettid);
+    timed_round("ecall往返(write 0字节)", empty_write);
+}
+
+// getpid和time从vDSO数据页读取，不进入内核
+static int time_call(void) {
+    return (int)time();
+}
+
+static void vdso_bench(void) {
+    uint64 t0 = time();
+    sleep(20);
+    uint64 t1 = time();
+
+    if (getpid() <= 0 || t1 < t0 + 20) {
+        printf("vDSO测试失败: pid=%d, 睡眠20ms前后time=%ld/%ld\n", getpid(), t0, t1);
+        return;
+    }
+    timed_round("vDSO getpid", getpid);
+    timed_round("vDSO time", time_call);
+}
+
+// 上下文切换开销：两个线程绑定到同一hart轮流yield，比较使用和不使用浮点时的开销。
+// 使用浮点的线程在yield前后修改浮点累加器，累加器跨越yield保存在浮点寄存器中，
+// 结果不对说明切换时浮点寄存器没有正确保存和恢复
+#define SWITCH_ROUNDS   2000
+
+static uint64 switch_mask;
+static int switch_use_fp;
+static int switch_bad;
+static struct sched_stat switch_stat[2];
+
+static void *switch_worker(void *arg) {
+    int me = (int)(uint64)arg;
+    double acc = me * 1000;
+
+    sched_setaffinity(0, switch_mask);
+    yield();
+    for (int i = 0; i < SWITCH_ROUNDS; i++) {
+        if (switch_use_fp) {
+            acc += 1.0;
+        }
+        yield();
+    }
+    if (switch_use_fp && (int)acc != me * 1000 + SWITCH_ROUNDS) {
+        switch_bad = 1;
+    }
+    sched_getstat(&switch_stat[me]);
+    return 0;
+}
+
+static void switch_round(int use_fp) {
+    struct uthread *t[2];
+    uint64 start = rdtime();
+
+    switch_use_fp = use_fp;
+    for (int i = 0; i < 2; i++) {
+        t[i] = thread_create(switch_worker, (void *)(uint64)i);
+    }
+    if (!t[0] || !t[1]) {
+        printf("上下文切换测试失败: 无法创建线程\n");
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        thread_join(t[i]);
+    }
+    uint64 ticks = rdtime() - start;
+    printf("上下文切换(%s浮点): %ld ns/次, 保存浮点%ld次, 加载浮点%ld次\n",
+           use_fp ? "使用" : "不使用", ticks * 1000 / TIMEBASE_MHZ / (2 * SWITCH_ROUNDS),
+           switch_stat[0].fpu_saves + switch_stat[1].fpu_saves,
+           switch_stat[0].fpu_restores + switch_stat[1].fpu_restores);
+}
+
+static void switch_bench(void) {
+    struct sched_stat st;
+
+    sched_getstat(&st);
+    switch_mask = 1ULL << st.cpu;
+    switch_bad = 0;
+    switch_round(0);
+    switch_round(1);
+    if (switch_bad) {
+        printf("上下文切换测试失败: 浮点寄存器在切换后被破坏\n");
+    }
+}
+
+// 用户内存访问：无效指针返回-1而不是使内核挂起，并测量read复制大块数据的速度
+#define UCOPY_ROUNDS    200
+#define UCOPY_UNMAPPED  0x60000000ULL   // 在用户地址范围内，但堆远没有增长到这里
+
+static char ucopy_buf[16384];
+
+static void uaccess_test(void) {
+    int fd = open("/echo", O_RDONLY);
+    if (fd < 0) {
+        printf("用户内存访问测试失败: 无法打开/echo\n");
+        return;
+    }
+    // 内核地址、未映射的用户地址、只读的代码段
+    int r1 = write(1, (void *)0x80200000ULL, 4);
+    int r2 = write(1, (void *)UCOPY_UNMAPPED, 16);
+    int r3 = read(fd, (void *)uaccess_test, 16);
+    close(fd);
+    if (r1 != -1 || r2 != -1 || r3 != -1) {
+        printf("用户内存访问测试失败: 无效指针返回 %d/%d/%d\n", r1, r2, r3);
+        return;
+    }
+
+    uint64 bytes = 0;
+    uint64 start = rdtime();
+    for (int i = 0; i < UCOPY_ROUNDS; i++) {
+        fd = open("/echo", O_RDONLY);
+        int n;
+        while ((n = read(fd, ucopy_buf, sizeof(ucopy_buf))) > 0) {
+            bytes += n;
+        }
+        close(fd);
+    }
+    uint64 ticks = rdtime() - start;
+    printf("用户内存访问测试通过: 无效指针返回-1, read复制 %ld KB/ms\n",
+           ticks ? bytes * TIMEBASE_MHZ * 1000 / 1024 / ticks : 0);
+}
+
+// 串口输出：一次写入几KB，write在数据进入内核发送缓冲区后就返回，不等待串口发送完
+#define UART_BENCH_LINES 32
+
+static void uart_bench(void) {
+    static char text[UART_BENCH_LINES * 64];
+
+    for (int i = 0; i < UART_BENCH_LINES; i++) {
+        for (int j = 0; j < 63; j++) {
+            text[i * 64 + j] = 'a' + (i + j) % 26;
+        }
+        text[i * 64 + 63] = '\n';
+    }
+    uint64 start = rdtime();
+    int n = write(1, text, sizeof(text));
+    uint64 ticks = rdtime() - start;
+    printf("串口输出: write %d 字节用时 %ld us\n", n, ticks / TIMEBASE_MHZ);
+}
+
+// 控制台输入模式切换。读取标准输入会阻塞到有输入为止，这里不读，
+// 交互输入由cat（不带参数时复制标准输入）处理
+static void console_mode_test(void) {
+    int old = console_mode(CONSOLE_RAW);
+    int raw = console_mode(-1);
+    console_mode(old);
+
+    if (old != CONSOLE_CANON || raw != CONSOLE_RAW || console_mode(-1) != CONSOLE_CANON) {
+        printf("控制台模式测试失败: %d/%d\n", old, raw);
+        return;
+    }
+    printf("控制台模式测试通过\n");
+}
+
+// 运行时打开SYSCALL日志：短时间内大量系统调用时每个调用点每秒最多输出40条，
+// 一秒后同一调用点再次输出时报告被抑制的条数
+#define LOG_STORM_CALLS 500
+
+static void log_level_test(void) {
+    int old = log_level("SYSCALL", LOG_DEBUG);
+
+    if (old != LOG_OFF || log_level("SYSCALL", -1) != LOG_DEBUG || log_level("NOSUCH", LOG_INFO) != -1) {
+        log_level("SYSCALL", old < 0 ? LOG_OFF : old);
+        printf("日志级别测试失败: %d\n", old);
+        return;
+    }
+    for (int i = 0; i < LOG_STORM_CALLS; i++) {
+        getpid();
+    }
+    sleep(1100);
+    getpid();
+    log_level("SYSCALL", old);
+    log_level(0, 0);
+    printf("日志级别测试通过: %d 次getpid，控制台上每个调用点最多 40 条，随后报告抑制的条数\n",
+           LOG_STORM_CALLS);
+}
+
+// 提交/完成队列：一次ring_enter完成多次写，与逐个ecall比较吞吐量
+#define RING_BENCH_OPS  (RING_ENTRIES * 100)
+
+static uint64 ops_per_sec(uint64 ops, uint64 ticks) {
+    return ticks ? ops * 1000000 * TIMEBASE_MHZ / ticks : 0;
+}
+
+static void ring_test(void) {
+    static const char *lines[] = { "提交/完成队列: 第一行\n", "提交/完成队列: 第二行\n",
+                                   "提交/完成队列: 第三行\n" };
+    struct ring_shared *r = ring_setup();
+    struct ring_cqe cqe;
+    uint64 start, ticks;
+    int bad = 0;
+
+    if (!r) {
+        printf("提交/完成队列测试失败: ring_setup出错\n");
+        return;
+    }
+
+    // 三次写和一次睡眠只需要一次系统调用，完成项按提交顺序返回
+    for (int i = 0; i < 3; i++) {
+        ring_prep(r, RING_OP_WRITE, 1, (uint64)lines[i], strlen(lines[i]), i);
+    }
+    ring_prep(r, RING_OP_SLEEP, 0, 0, 10, 3);
+    if (ring_submit(r) != 4) {
+        bad = 1;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (ring_reap(r, &cqe) < 0 || cqe.user_data != (uint64)i ||
+            (i < 3 && cqe.res != (int64)strlen(lines[i]))) {
+            bad = 1;
+        }
+    }
+    if (bad) {
+        printf("提交/完成队列测试失败\n");
+        return;
+    }
+
+    // 长度为0的写：经过完整的系统调用路径但不产生输出
+    start = rdtime();
+    for (int i = 0; i < RING_BENCH_OPS; i++) {
+        write(1, "", 0);
+    }
+    ticks = rdtime() - start;
+    printf("逐个ecall: %ld 次写/秒\n", ops_per_sec(RING_BENCH_OPS, ticks));
+
+    start = rdtime();
+    for (int done = 0; done < RING_BENCH_OPS; ) {
+        while (ring_prep(r, RING_OP_WRITE, 1, (uint64)"", 0, done) == 0) {
+        }
+        ring_submit(r);
+        while (ring_reap(r, &cqe) == 0) {
+            done++;
+        }
+    }
+    ticks = rdtime() - start;
+    printf("提交/完成队列: %ld 次写/秒 (每批%d个)\n", ops_per_sec(RING_BENCH_OPS, ticks),
+           RING_ENTRIES);
+}
+
+// 系统调用名称，与内核使用同一张表
+static const char *syscall_names[NSYSCALL] = {
+#define SYSCALL(num, name) [num] = #name,
+#include "../include/syscall_list.h"
+#undef SYSCALL
+};
+
+// 输出到目前为止各系统调用的次数、平均耗时和延迟分布
+static void syscall_profile(void) {
+    struct syscall_stat st;
+
+    printf("系统调用统计:\n");
+    for (int i = 1; i < NSYSCALL; i++) {
+        if (syscall_stat(i, &st) < 0 || st.count == 0) {
+            continue;
+        }
+        printf("  %s: %ld 次, 平均 %ld cycles, 分布:", syscall_names[i], st.count,
+               st.cycles / st.count);
+        for (int b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+            if (st.hist[b]) {
+                printf(" 2^%d:%ld", b, st.hist[b]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+// 输出各hart时钟中断的进入和退出延迟分布（桶b表示[2^b, 2^(b+1)) tick，1 tick = 100ns），
+// 再让内核输出它自己的汇总
+static void irq_latency_report(void) {
+    struct irq_stat st;
+
+    printf("中断延迟统计:\n");
+    // 超出内核hart数时irq_stat返回-1，不在线的hart没有中断
+    for (int h = 0; irq_stat(h, IRQ_SRC_TIMER, &st) == 0; h++) {
+        if (st.count == 0) {
+            continue;
+        }
+        printf("  hart %d 时钟中断 %ld 次, 进入分布:", h, st.count);
+        for (int b = 0; b < IRQ_HIST_BUCKETS; b++) {
+            if (st.entry_hist[b]) {
+                printf(" 2^%d:%ld", b, st.entry_hist[b]);
+            }
+        }
+        printf(", 退出分布:");
+        for (int b = 0; b < IRQ_HIST_BUCKETS; b++) {
+            if (st.exit_hist[b]) {
+                printf(" 2^%d:%ld", b, st.exit_hist[b]);
+            }
+        }
+        printf("\n");
+    }
+    irq_stat(0, 0, 0);
+}
+
+// 系统调用跟踪：跟踪自己的几次系统调用，再取出记录按strace的格式输出
+#define STRACE_MAX 32
+
+static void strace_test(void) {
+    static struct strace_rec recs[STRACE_MAX];
+    uint64 lost;
+    int fd, n;
+
+    strace_read(recs, STRACE_MAX, &lost);   // 丢弃之前的记录
+    if (strace_ctl(0, 1) < 0) {
+        printf("跟踪测试失败: strace_ctl出错\n");
+        return;
+    }
+    gettid();
+    write(1, "", 0);
+    sleep(1);
+    fd = open("/echo", O_RDONLY);
+    close(fd);
+    strace_ctl(0, 0);
+
+    n = strace_read(recs, STRACE_MAX, &lost);
+    printf("跟踪记录 %d 条, 覆盖 %ld 条:\n", n, lost);
+    for (int i = 0; i < n; i++) {
+        struct strace_rec *r = &recs[i];
+        printf("  [hart %d] tid %d %s(0x%lx, 0x%lx, 0x%lx) = %ld <%ld us>\n", r->cpu, r->pid,
+               r->num < NSYSCALL && syscall_names[r->num] ? syscall_names[r->num] : "?",
+               r->args[0], r->args[1], r->args[2], (int64)r->ret,
+               (r->exit - r->enter) / TIMEBASE_MHZ);
+    }
+}
+
+// 格式化吞吐量：整数和字符串分别测量snprintf，整数转换与逐位除法的做法比较
+#define FMT_BENCH_ITERS 20000
+
+// 参考实现：每一位数字做一次64位除法和取余
+static int naive_utoa(uint64 v, char *buf) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    for (int i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+static void fmt_bench(void) {
+    static const char name[] = "kworker/0";
+    char buf[128], ref[24];
+    uint64 start, ticks, bytes = 0;
+    int bad = 0;
+
+    // 结果先与参考实现核对
+    for (int i = 0; i < 1000; i++) {
+        uint64 v = 0x9e3779b97f4a7c15ULL * i;
+        snprintf(buf, sizeof(buf), "%lu", v);
+        naive_utoa(v, ref);
+        bad |= strcmp(buf, ref) != 0;
+    }
+    snprintf(buf, sizeof(buf), "%d|%5d|%05d|%x|%08lx|%s|%6s", -42, 7, -7, 0xbeef, 0x12UL, "a", "bc");
+    if (bad || strcmp(buf, "-42|    7|-0007|beef|00000012|a|    bc") != 0) {
+        printf("格式化测试失败: %s\n", buf);
+        return;
+    }
+
+    start = rdtime();
+    for (int i = 0; i < FMT_BENCH_ITERS; i++) {
+        bytes += snprintf(buf, sizeof(buf), "%lu %ld %lx\n", 0x9e3779b97f4a7c15ULL * i,
+                          -(int64)i * 7919, 0xdeadbeefULL + i);
+    }
+    ticks = rdtime() - start;
+    printf("格式化: 整数 %lu 次/秒, %lu KB/秒\n", ops_per_sec(FMT_BENCH_ITERS, ticks),
+           ops_per_sec(bytes, ticks) / 1024);
+
+    start = rdtime();
+    for (int i = 0; i < FMT_BENCH_ITERS; i++) {
+        snprintf(buf, sizeof(buf), "%lu", 0x9e3779b97f4a7c15ULL * i);
+    }
+    ticks = rdtime() - start;
+    uint64 table = ticks;
+    start = rdtime();
+    for (int i = 0; i < FMT_BENCH_ITERS; i++) {
+        naive_utoa(0x9e3779b97f4a7c15ULL * i, buf);
+    }
+    ticks = rdtime() - start;
+    printf("格式化: 64位十进制 每次 %lu ns（逐位除法 %lu ns）\n",
+           table * 1000 / TIMEBASE_MHZ / FMT_BENCH_ITERS, ticks * 1000 / TIMEBASE_MHZ / FMT_BENCH_ITERS);
+
+    bytes = 0;
+    start = rdtime();
+    for (int i = 0; i < FMT_BENCH_ITERS; i++) {
+        bytes += snprintf(buf, sizeof(buf), "任务 %s 状态 %12s 说明 %s\n", name,
+                          (i & 1) ? "运行" : "睡眠", "格式化字符串参数的吞吐量");
+    }
+    ticks = rdtime() - start;
+    printf("格式化: 字符串 %lu 次/秒, %lu KB/秒\n", ops_per_sec(FMT_BENCH_ITERS, ticks),
+           ops_per_sec(bytes, ticks) / 1024);
+}
+
+// 亲和性测试：依次绑定到每个在线hart并确认在该hart上运行，
+// 然后在最后一个hart（隔离时通常是被隔离的hart）上测量抖动
+static void affinity_test(void) {
+    uint64 old, online;
+    struct sched_stat st;
+    int last = -1;
+
+    // 包含所有位的掩码由内核截取为在线hart（包括隔离的hart）
+    if (sched_getaffinity(0, &old) < 0 || sched_setaffinity(0, ~0ULL) < 0 ||
+        sched_getaffinity(0, &online) < 0) {
+        printf("亲和性测试失败: 系统调用出错\n");
+        return;
+    }
+    for (int h = 0; h < 64; h++) {
+        if (!((online >> h) & 1)) {
+            continue;
+        }
+        sched_setaffinity(0, 1ULL << h);
+        yield();
+        sched_getstat(&st);
+        if (st.cpu != (uint64)h) {
+            printf("亲和性测试失败: 绑定到hart %d, 实际运行在hart %ld\n", h, st.cpu);
+            sched_setaffinity(0, old);
+            return;
+        }
+        last = h;
+    }
+    printf("亲和性测试通过: 默认掩码 0x%lx, 在线hart 0x%lx\n", old, online);
+
+    printf("hart %d 上的最大打断间隔: %ld us\n", last, measure_jitter());
+    sched_setaffinity(0, old);
+}
+
+int main(int argc, char *argv[]) {
     printf("基本测试: Hello, RISC-V OS!\n");
     
     // 测试整数
@@ -9,6 +1041,63 @@ int main() {
     // 测试十六进制
     printf("十六进制测试: 0x%x\n", 0xabcd);
     printf("十六进制带宽度: 0x%08x\n", 0x123);
+
+    // 测试EDF实时调度
+    edf_test();
+    edf_multi_test();
+
+    // 测试spawn及其与fork+exec的开销对比
+    spawn_test();
+    spawn_bench();
+
+    // 测试用户线程、TLS以及多hart并行
+    thread_test();
+    thread_bench();
+
+    // 测试futex同步原语及加锁吞吐量
+    sync_test();
+    lock_bench();
+
+    // 测试亲和性和隔离的hart
+    affinity_test();
+
+    // 测量系统调用快速路径的往返开销
+    ecall_bench();
+    vdso_bench();
+
+    // 比较使用和不使用浮点时的任务切换开销
+    switch_bench();
+
+    // 测试系统调用对用户指针的检查和复制速度
+    uaccess_test();
+
+    // 测量大块控制台输出的写入时间
+    uart_bench();
+    console_mode_test();
+
+    // 运行时调整内核日志级别，测试日志限速
+    log_level_test();
+
+    // 测试批量系统调用
+    ring_test();
+
+    // 输出各系统调用的内核耗时分布
+    syscall_profile();
+
+    // 测量共用格式化实现的吞吐量
+    fmt_bench();
+
+    // 输出中断延迟分布
+    irq_latency_report();
+
+    // 跟踪自己的系统调用
+    strace_test();
+
+    // 测试exec：用initramfs中的echo替换当前程序，成功时不返回
+    printf("%s: 执行/echo\n", argc > 0 ? argv[0] : "init");
+    char *echo_argv[] = { "echo", "hello", "from", "exec", 0 };
+    exec("/echo", echo_argv);
+    printf("exec失败\n");
     /*
     // 测试长整数
     printf("长整数测试: %ld\n", 1234567890L);